@@ -0,0 +1,164 @@
+/*
+  ClearPathBurstTable.h - Recorded step bursts of a move, for replaying it without the move calculations- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  A ClearPathBurstTable holds the number of steps a move sends on each tick of the ISR, so a move which is
+  repeated many times can be worked out once and then played back with one table read per tick.
+  The steps are stored as runs: a number of steps sent on each of a number of ticks, so the cruise of a move
+  at a whole number of counts per tick takes a few bytes however long it is.
+
+  A table either lives in RAM, in an array of ClearPathBurstRun passed to the constructor, and is filled by
+  ClearPathMotorSD::recordMove() or moveCached(), or is a table already built in flash (PROGMEM), either as
+  runs or as one step count per tick.  ClearPathProfile.h builds the latter at compile time.
+
+   ClearPathBurstRun pickRuns[64];
+   ClearPathBurstTable pick(pickRuns, 64);		// up to 64 runs in RAM
+   ...
+   X.moveCached(pick, 12000);	// works the move out the first time, replays it every time after
+
+  The functions for a ClearPathBurstTable are:
+
+   distance() - returns the length of the recorded move in counts, negative for a move backwards
+
+   runs() - returns the number of runs in the table (ticks for a table of steps per tick), 0 if nothing is recorded
+
+   ticks() - returns the number of ticks the move takes
+
+   run() - returns one run of the table, from RAM or flash
+
+   clear() - empties a RAM table
+ */
+#ifndef ClearPathBurstTable_h
+#define ClearPathBurstTable_h
+#include "Arduino.h"
+
+// Steps sent on each of ticks ticks, in order
+struct ClearPathBurstRun
+{
+	uint8_t steps;
+	uint8_t ticks;
+};
+
+class ClearPathBurstTable
+{
+  public:
+  /*
+	A table in RAM with room for maxRuns runs, empty until a move is recorded into it
+  */
+  ClearPathBurstTable(ClearPathBurstRun* runs, uint16_t maxRuns)
+  {
+	_ram=runs;
+	_runs=runs;
+	_steps=0;
+	_maxRuns=maxRuns;
+	_flash=false;
+	clear();
+  }
+
+  /*
+	A table of numRuns runs already built in flash (PROGMEM) for a move of dist counts
+  */
+  ClearPathBurstTable(const ClearPathBurstRun* runs, uint16_t numRuns, long dist)
+  {
+	_ram=0;
+	_runs=runs;
+	_steps=0;
+	_maxRuns=numRuns;
+	_numRuns=numRuns;
+	_flash=true;
+	_dist=dist;
+	_velMax=0;
+	_accelMax=0;
+	_maxBurst=0;
+	_tickHz=0;
+	_fractionalBits=0;
+  }
+
+  /*
+	A table of numTicks step counts, one per tick, already built in flash (PROGMEM) for a move of dist counts
+  */
+  ClearPathBurstTable(const uint8_t* steps, uint16_t numTicks, long dist)
+  {
+	_ram=0;
+	_runs=0;
+	_steps=steps;
+	_maxRuns=numTicks;
+	_numRuns=numTicks;
+	_flash=true;
+	_dist=dist;
+	_velMax=0;
+	_accelMax=0;
+	_maxBurst=0;
+	_tickHz=0;
+	_fractionalBits=0;
+  }
+
+  long distance() const { return _dist; }
+  uint16_t runs() const { return _numRuns; }
+
+  unsigned long ticks() const
+  {
+	unsigned long n=0;
+	for(uint16_t i=0;i<_numRuns;i++)
+		n+=run(i).ticks;
+	return n;
+  }
+
+  ClearPathBurstRun run(uint16_t i) const
+  {
+	ClearPathBurstRun r;
+	if(_steps)
+	{
+		r.steps=pgm_read_byte(&_steps[i]);
+		r.ticks=1;
+	}
+	else if(_flash)
+	{
+		r.steps=pgm_read_byte(&_runs[i].steps);
+		r.ticks=pgm_read_byte(&_runs[i].ticks);
+	}
+	else
+		r=_runs[i];
+	return r;
+  }
+
+  void clear()
+  {
+	if(_flash)
+		return;
+	_numRuns=0;
+	_dist=0;
+	_velMax=0;
+	_accelMax=0;
+	_maxBurst=0;
+	_tickHz=0;
+	_fractionalBits=0;
+  }
+
+  protected:
+  friend class ClearPathMotorSD;
+  ClearPathBurstRun* _ram;			// The runs when the table is in RAM, 0 for a flash table
+  const ClearPathBurstRun* _runs;		// The runs, in RAM or flash...
+  const uint8_t* _steps;				// ...or the steps of each tick, in flash
+  uint16_t _maxRuns;					// Room for this many runs
+  uint16_t _numRuns;					// Runs recorded
+  boolean _flash;						// True if _runs is in flash
+  // The move the table was recorded for, a move is only replayed from the table if all of these match
+  long _dist;
+  long _velMax;
+  long _accelMax;
+  uint16_t _maxBurst;
+  uint16_t _tickHz;
+  uint8_t _fractionalBits;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+  ClearPathConfig.h - Compile time options for the ClearPath step and direction library- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  These options change how the library itself is compiled, so they must be changed here (or passed as -D build
+  flags), a #define in the sketch is not seen by the library's .cpp files.
+
+   CLEARPATH_BATCHED_AXES - 0: each ClearPathMotorSD keeps its own move state, and the ISR asks each motor in turn
+                            1: the ClearPathStepGen keeps the move state of all its motors in one array and
+                               updates every axis in a single call from the ISR.  Each ClearPathMotorSD is then
+                               only a handle, and must be passed to a ClearPathStepGen before it is enabled,
+                               configured or moved.  All motors use Q22.10 in this mode.  The steps sent are the
+                               same as with 0, the ISR time of the two has not been compared on hardware, time
+                               both with Examples/ISRBenchmark before picking one for speed.
+
+   CLEARPATH_TIMER        - the hardware timer a ClearPathStepGen runs on unless ClearPathStepGen::setTimer()
+                            picks another, see ClearPathTimer.h
+                            2: Timer2 (default), which tone() and MsTimer2 also use
+                            1: Timer1, which the Servo library also uses.  16 bit, so the tick is timed in 0.5us
+                               counts instead of 2us
+                            3, 4, 5: Timer3, 4 or 5 on an Arduino Mega, also 16 bit
+
+   CLEARPATH_TIMERS       - the timers the library takes the interrupts of, one bit per timer, ie:
+                            (1<<2)|(1<<1) for Timer2 and Timer1 so two ClearPathStepGens can run at once.
+                            Defaults to just CLEARPATH_TIMER, and must include it.
+
+   CLEARPATH_TICK_HZ      - the tick rate of a ClearPathStepGen unless ClearPathStepGen::setTimer() sets another,
+                            2000 (default).  Velocities and accelerations are converted using the rate of the
+                            step generator a motor is attached to.
+
+   CLEARPATH_SNAPSHOTS    - 0: no snapshots, getSnapshot() returns no axes (default)
+                            1: the ISR publishes every axis' position, velocity and state each tick for
+                               ClearPathStepGen::getSnapshot(), costing a few microseconds per tick and about
+                               120 bytes of RAM per step generator for the double buffer
+
+   CLEARPATH_ISR_STATS    - 1: the ISR times itself against the timer driving it and keeps the minimum, maximum
+                               and mean time, and a histogram, for ClearPathStepGen::getISRStats()
+                            0: no timing (default)
+
+   CLEARPATH_INTERRUPTIBLE_ISR - 0: the ISR keeps interrupts off while it calculates and pulses every axis (default),
+                                    which can take most of a tick when the motors are fast
+                                 1: the ISR masks only its own timer interrupt and lets every other interrupt
+                                    (Serial, millis() etc.) run.  Interrupts are only off while PORTB is written,
+                                    a few microseconds per pulse.  Each tick takes slightly longer, and step
+                                    pulses are stretched whenever another interrupt runs during one.
+
+   CLEARPATH_SPREAD_STEPS - 0: each tick's steps are sent back to back at the start of the tick (default)
+                            2 to 125: each tick's steps are spread evenly across the tick in up to this many
+                               slots, timed by the tick timer's second (B) compare.  Every slot costs an interrupt,
+                               around 10us with 6 axes, so 25 slots (one every 20us) is a sensible most.
+
+   CLEARPATH_PLAN_TICKS   - 0: the ISR works out each tick's steps itself (default)
+                            2 to 255: the moves are planned ahead from loop() by ClearPathStepGen::plan() into a
+                               buffer of this many ticks (one less is used), and the ISR only takes the next tick's
+                               steps from the buffer and sends them, so it takes the same short time on every tick.
+                               Costs 12 bytes of RAM per tick per step generator, 16 (8ms at 2kHz) is a good start.
+
+   CLEARPATH_SHAPER_TICKS - 0: no input shaping (default)
+                            2 to 255: each motor has a delay line this many ticks long for an input shaper, see
+                               ClearPathMotorSD::setShaper().  A shaper can cancel ringing down to a frequency of
+                               tick rate / (2 * (CLEARPATH_SHAPER_TICKS-1)) Hz with ZV, and twice that with ZVD,
+                               ie: 128 gives 7.9Hz (ZV) and 15.7Hz (ZVD) at 2kHz.  Costs this many bytes of RAM
+                               plus 12 per motor.
+
+   CLEARPATH_SYNC_MOVES   - 1: ClearPathStepGen::moveSync() is available (default).  Each step generator keeps the
+                               state of the move its motors follow, about 104 bytes of RAM (more with a shaper),
+                               plus 7 bytes per motor
+                            0: moveSync() always returns false, and that RAM is saved
+ */
+#ifndef ClearPathConfig_h
+#define ClearPathConfig_h
+
+#ifndef CLEARPATH_BATCHED_AXES
+#define CLEARPATH_BATCHED_AXES 0
+#endif
+
+#ifndef CLEARPATH_TIMER
+#define CLEARPATH_TIMER 2
+#endif
+
+#ifndef CLEARPATH_TIMERS
+#define CLEARPATH_TIMERS (1<<CLEARPATH_TIMER)
+#endif
+
+#if !(CLEARPATH_TIMERS & (1<<CLEARPATH_TIMER))
+#error "CLEARPATH_TIMER must be one of the timers in CLEARPATH_TIMERS"
+#endif
+
+#ifndef CLEARPATH_TICK_HZ
+#define CLEARPATH_TICK_HZ 2000
+#endif
+
+#ifndef CLEARPATH_SNAPSHOTS
+#define CLEARPATH_SNAPSHOTS 0
+#endif
+
+#ifndef CLEARPATH_ISR_STATS
+#define CLEARPATH_ISR_STATS 0
+#endif
+
+#ifndef CLEARPATH_INTERRUPTIBLE_ISR
+#define CLEARPATH_INTERRUPTIBLE_ISR 0
+#endif
+
+#ifndef CLEARPATH_SPREAD_STEPS
+#define CLEARPATH_SPREAD_STEPS 0
+#endif
+
+#if CLEARPATH_SPREAD_STEPS == 1 || CLEARPATH_SPREAD_STEPS > 125
+#error "CLEARPATH_SPREAD_STEPS must be 0, or 2 to 125"
+#endif
+
+#ifndef CLEARPATH_PLAN_TICKS
+#define CLEARPATH_PLAN_TICKS 0
+#endif
+
+#if CLEARPATH_PLAN_TICKS == 1 || CLEARPATH_PLAN_TICKS > 255
+#error "CLEARPATH_PLAN_TICKS must be 0, or 2 to 255"
+#endif
+
+#ifndef CLEARPATH_SHAPER_TICKS
+#define CLEARPATH_SHAPER_TICKS 0
+#endif
+
+#if CLEARPATH_SHAPER_TICKS == 1 || CLEARPATH_SHAPER_TICKS > 255
+#error "CLEARPATH_SHAPER_TICKS must be 0, or 2 to 255"
+#endif
+
+#ifndef CLEARPATH_SYNC_MOVES
+#define CLEARPATH_SYNC_MOVES 1
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/*
+  ClearPathFixed.h - Fixed point formats used by the ClearPath step and direction library- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  ClearPathQ<IntBits, FracBits> describes a signed fixed point format with IntBits integer bits
+  (including the sign) and FracBits fractional bits, ie: ClearPathQ<22,10> is Q22.10.
+
+  Values are kept as plain signed integers (raw_t) so all arithmetic is ordinary integer arithmetic,
+  and because the format is a template argument every shift below is a constant the compiler can fold.
+  On an 8-bit AVR this turns the shifts by a runtime variable into a few register moves.
+
+  The functions for a ClearPathQ are:
+
+   fromCounts() - converts a whole number of counts into the format
+
+   toCounts() - converts a value back into whole counts, rounding down
+
+   ONE - the raw value of one count
+
+  CLEARPATH_MAX_MOVE(fracBits) is the longest move a motor tracking its moves in Q(32-fracBits).fracBits can make.
+ */
+#ifndef ClearPathFixed_h
+#define ClearPathFixed_h
+#include <stdint.h>
+
+// Picks the smallest signed integer which holds the given number of bits
+template<bool Wide> struct ClearPathQStorage { typedef int32_t type; };
+template<> struct ClearPathQStorage<false> { typedef int16_t type; };
+
+template<uint8_t IntBits, uint8_t FracBits>
+struct ClearPathQ
+{
+	static_assert(IntBits + FracBits <= 32, "ClearPathQ formats are limited to 32 bits");
+
+	typedef typename ClearPathQStorage<(IntBits + FracBits > 16)>::type raw_t;
+
+	static const uint8_t INT_BITS = IntBits;
+	static const uint8_t FRAC_BITS = FracBits;
+	static const raw_t ONE = (raw_t)1 << FracBits;
+
+	static inline raw_t fromCounts(raw_t counts)
+	{
+		return counts * ONE;		// a multiply by a constant power of two, so it compiles to shifts
+	}
+
+	static inline raw_t toCounts(raw_t value)
+	{
+		return value >> FracBits;
+	}
+};
+
+// The longest move, in counts, a 32 bit format with fracBits fractional bits can hold.  A ramped move's position
+// can pass its target by up to one tick at the highest velocity (50 counts, plus half a count of acceleration)
+// before it is put back on it, so that much is kept free below the top of the format.
+#define CLEARPATH_MAX_MOVE(fracBits) ((1L<<(31-(fracBits)))-52)
+
+#endif
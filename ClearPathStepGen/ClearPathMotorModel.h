@@ -0,0 +1,281 @@
+/*
+  ClearPathMotorModel.h - A model of how a ClearPath motor follows the steps it is sent- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  A ClearPathMotorModel is a virtual motor.  It is given the steps of each tick, as calcSteps() or a
+  ClearPathBurstTable sends them, and works out where the shaft would be: the motor's RAS smoothing of the
+  commanded position, followed by a servo loop with a velocity and an acceleration (torque) limit.
+  It needs no hardware or step generator, so velocity, acceleration and RAS can be tuned for the shortest
+  move and settle from a sketch, in simavr, or compiled on a PC.  A load which rings, such as a tool on the
+  end of a gantry, can be added to see how much a move excites it.
+
+   ClearPathMotorModel model;
+   model.setRAS(16);					// RAS of 16ms
+   model.setMaxAccel(600000);			// what the motor's torque can do, in counts/sec/sec
+   ...
+   model.tick(steps);					// once per tick, with the signed steps sent
+   model.error();						// commanded position minus the modelled position
+
+  The model is an approximation, not a copy of the motor's firmware:
+  - RAS is modelled as two moving averages of the commanded position, each half the RAS time long, which
+	turns every step into an S shaped curve RAS long, and delays the motion by half the RAS time
+  - the servo follows that curve with feed forward of its velocity and acceleration and a critically damped
+	loop of setServo() Hz, so it only falls behind the curve when a limit is reached
+  It uses floating point and is slow on an 8 bit AVR (about 100us a tick), so it is for working out settings,
+  not for running next to a step generator.
+
+  The functions for a ClearPathMotorModel are:
+
+   setRAS() - sets the RAS time in ms (0 turns it off, up to CLEARPATH_MODEL_TAPS*2000/tickHz)
+
+   setServo() - sets the servo loop bandwidth in Hz and damping ratio (default 30Hz, 1.0)
+
+   setMaxVel() / setMaxAccel() - limits of the motor itself in counts/sec and counts/sec/sec, 0 for none
+
+   setLoad() - adds a load on a spring, which rings at a frequency in Hz with a damping ratio, 0Hz for none
+
+   reset() - puts the motor at rest at a position, and clears the history and maxError()
+
+   tick() - runs one tick, with the steps sent on it (negative for steps backwards)
+
+   play() - runs every tick of a ClearPathBurstTable, and then until the motor settles or the tick limit
+
+   commanded() - the commanded position, in counts
+
+   position() / velocity() / error() - the modelled position (counts), velocity (counts/sec), and the commanded
+	position minus the modelled one, all of the load when there is one
+
+   motorPosition() - the modelled position of the motor's shaft
+
+   maxError() - the largest error() since reset()
+
+   settled() - true once the model is within a window of the commanded position and nearly stopped
+ */
+#ifndef ClearPathMotorModel_h
+#define ClearPathMotorModel_h
+#include "Arduino.h"
+#include "ClearPathConfig.h"
+#include "ClearPathBurstTable.h"
+
+#define CLEARPATH_MODEL_TAPS 64			// Longest moving average in ticks, half the longest RAS (64ms at 2kHz)
+#define CLEARPATH_MODEL_SUBSTEPS 4		// Servo updates per tick
+
+class ClearPathMotorModel
+{
+  public:
+  ClearPathMotorModel(uint16_t tickHz=CLEARPATH_TICK_HZ)
+  {
+	_hz=tickHz;
+	_taps=0;
+	_velMax=0;
+	_accelMax=0;
+	setServo(30, 1.0);
+	setLoad(0, 0);
+	reset(0);
+  }
+
+  /*
+	Sets the RAS time in ms.  The history is cleared, so set it before a move
+  */
+  void setRAS(uint8_t ms)
+  {
+	unsigned long taps=((unsigned long)ms*_hz+1000)/2000;
+	if(ms && taps<1)
+		taps=1;
+	_taps= taps>CLEARPATH_MODEL_TAPS ? CLEARPATH_MODEL_TAPS : taps;
+	reset(_commanded);
+  }
+
+  void setServo(float bandwidthHz, float damping)
+  {
+	_wn=2*PI*bandwidthHz;
+	_zeta=damping;
+  }
+
+  void setMaxVel(long velMax) { _velMax=velMax; }
+  void setMaxAccel(long accelMax) { _accelMax=accelMax; }
+
+  /*
+	Adds a load which follows the motor through a spring, ringing at freqHz with the damping ratio damping.
+	The load does not push back on the motor.
+  */
+  void setLoad(float freqHz, float damping)
+  {
+	_lw=2*PI*freqHz;
+	_lzeta=damping;
+  }
+
+  /*
+	Puts the motor and its command at rest at position, with a full history of that position
+  */
+  void reset(long position)
+  {
+	_commanded=position;
+	_origin=position;
+	_x=0;
+	_v=0;
+	_y=0;
+	_yv=0;
+	_r=0;
+	_rv=0;
+	_maxError=0;
+	_next=0;
+	_quiet=2*CLEARPATH_MODEL_TAPS;
+	_sum1=position*_taps;
+	_sum2=(int64_t)position*_taps*_taps;
+	for(uint8_t i=0;i<_taps;i++)
+	{
+		_hist1[i]=position;
+		_hist2[i]=_sum1;
+	}
+  }
+
+  /*
+	Runs one tick, with the steps sent on it
+  */
+  void tick(long steps)
+  {
+	_commanded+=steps;
+	if(steps)
+		_quiet=0;
+	else if(_quiet<2*CLEARPATH_MODEL_TAPS)
+		_quiet++;
+
+	//RAS: two moving averages of the commanded position, kept as exact sums
+	float r;
+	if(_taps)
+	{
+		_sum1+=_commanded-_hist1[_next];
+		_hist1[_next]=_commanded;
+		_sum2+=_sum1-_hist2[_next];
+		_hist2[_next]=_sum1;
+		if(++_next>=_taps)
+			_next=0;
+		r=(float)(_sum2-(int64_t)_origin*_taps*_taps)/((long)_taps*_taps);
+	}
+	else
+		r=(float)(_commanded-_origin);
+
+	//Servo: follow the smoothed position with feed forward, within the motor's limits
+	float rv=(r-_r)*_hz;
+	float ra=(rv-_rv)*_hz;
+	float dt=1.0/((float)_hz*CLEARPATH_MODEL_SUBSTEPS);
+	for(uint8_t i=0;i<CLEARPATH_MODEL_SUBSTEPS;i++)
+	{
+		float rs=_r+rv*dt*(i+1);	//the smoothed position moves evenly across the tick
+		float a=ra+_wn*_wn*(rs-_x)+2*_zeta*_wn*(rv-_v);
+		if(_accelMax && a>_accelMax)
+			a=_accelMax;
+		else if(_accelMax && a<-_accelMax)
+			a=-_accelMax;
+		_v+=a*dt;
+		if(_velMax && _v>_velMax)
+			_v=_velMax;
+		else if(_velMax && _v<-_velMax)
+			_v=-_velMax;
+		_x+=_v*dt;
+		if(_lw>0)
+		{
+			//The load is pulled along by the motor through the spring
+			_yv+=(_lw*_lw*(_x-_y)+2*_lzeta*_lw*(_v-_yv))*dt;
+			_y+=_yv*dt;
+		}
+		else
+		{
+			_y=_x;
+			_yv=_v;
+		}
+	}
+	_r=r;
+	_rv=rv;
+
+	//Keep the floating point values small, so they stay precise far from zero
+	long shift=(long)_x;
+	_origin+=shift;
+	_x-=shift;
+	_y-=shift;
+	_r-=shift;
+
+	float e=error();
+	if(e<0)
+		e=-e;
+	if(e>_maxError)
+		_maxError=e;
+  }
+
+  /*
+	Runs every tick of table, then keeps ticking with no steps until the model has settled within window counts
+	or maxTicks ticks have run in all.  It returns the ticks run, so the move and settle time is that over the tick rate.
+  */
+  unsigned long play(const ClearPathBurstTable& table, float window, unsigned long maxTicks)
+  {
+	unsigned long ticks=0;
+	int sign= table.distance()<0 ? -1 : 1;
+	for(uint16_t i=0;i<table.runs();i++)
+	{
+		ClearPathBurstRun run=table.run(i);
+		for(uint8_t j=0;j<run.ticks;j++,ticks++)
+			tick(sign*(long)run.steps);
+	}
+	while(ticks<maxTicks && !settled(window))
+	{
+		tick(0);
+		ticks++;
+	}
+	return ticks;
+  }
+
+  long commanded() const { return _commanded; }
+  float position() const { return _origin+_y; }
+  float motorPosition() const { return _origin+_x; }
+  float velocity() const { return _yv; }
+  float error() const { return (float)(_commanded-_origin)-_y; }
+  float maxError() const { return _maxError; }
+
+  /*
+	True once the last step has passed through the RAS, the error is within window counts,
+	and the motor is moving slower than one window per 10ms
+  */
+  boolean settled(float window) const
+  {
+	float e=error();
+	float v=_yv;
+	return _quiet>=2*_taps && (e<0 ? -e : e)<=window && (v<0 ? -v : v)<=window*100;
+  }
+
+  protected:
+  uint16_t _hz;
+  uint8_t _taps;						// Length of each moving average, 0 with RAS off
+  uint8_t _next;						// Oldest entry of both histories
+  long _hist1[CLEARPATH_MODEL_TAPS];	// Commanded positions of the last _taps ticks
+  long _hist2[CLEARPATH_MODEL_TAPS];	// Sums of the first average on the last _taps ticks
+  long _sum1;
+  int64_t _sum2;
+  unsigned long _quiet;				// Ticks since a step was sent
+  long _commanded;
+  long _origin;						// The floating point positions below are measured from here
+  float _x;							// Modelled position and velocity of the motor...
+  float _v;
+  float _y;							// ...and of the load
+  float _yv;
+  float _r;							// Smoothed command and its velocity on the last tick
+  float _rv;
+  float _wn;
+  float _zeta;
+  float _lw;
+  float _lzeta;
+  long _velMax;
+  long _accelMax;
+  float _maxError;
+};
+
+#endif
@@ -36,19 +36,47 @@
 
    enable() - enables the motor
 
-   getCommandedPosition() - Returns the absolute cmomanded position where the position on enable=0
+   getCommandedPosition() - Returns the absolute cmomanded position, 0 until setPosition() is called
+
+   setPosition() - sets the commanded position to a value, ie: 0 to re-zero the motor where it is
+
+   moveTo() - moves to an absolute position, the distance is worked out from the commanded position
+
+   setSoftLimits() - sets the range of commanded positions moves are kept within, rejecting or clipping those that leave it
+
+   clearSoftLimits() - removes the soft limits
+
+   getLimitStops() - returns how many moves the ISR stopped at a soft limit
 
    readHLFB() - Returns the value of the motor's HLFB Pin
 
    setMaxVel() - sets the maximum veloctiy
 
-   setMaxAccel() - sets the acceleration
+   setMaxAccel() - sets the acceleration, returns false if it had to be reduced to fit
+
+   setMaxStepsPerTick() - sets the most steps sent in one tick, extra steps are sent on the following ticks
+
+   getSaturatedTicks() - returns how many ticks were limited by setMaxStepsPerTick()
+
+   setFastStepsPerTick() - sets the steps moveFast() sends on every tick
+
+   setShaper() - shapes the motor's steps with a ZV or ZVD input shaper to cancel ringing at a frequency
 
    commandDone() - returns wheter or not there is a valid current command
+
+   recordMove() - works out a move and stores the steps of each tick in a ClearPathBurstTable, without moving
+
+   playMove() - makes the move stored in a ClearPathBurstTable, reading its steps from the table each tick
+
+   moveCached() - plays a move from a ClearPathBurstTable, recording it first if the table holds a different move
+
+  Positions, velocities and accelerations are tracked in Q22.10 fixed point by default, or in the format
+  given to ClearPathMotorSDQ<> for motors that need finer velocity resolution.
    
  */
 #include "Arduino.h"
 #include "ClearPathMotorSD.h"
+#include "ClearPathStepGen.h"
 
 
 /*		
@@ -57,60 +85,86 @@
 	to send in the next ISR.
 */
 int ClearPathMotorSD::calcSteps()
+{
+	return axis().calcStepsQ<10>();
+}
+
+/*
+	This is the body of calcSteps() for a motor tracking its move in Q(32-FracBits).FracBits.
+	The format is fixed at compile time so every conversion to and from counts is a constant shift.
+
+	This runs for every axis on every tick, so it is written for an 8-bit AVR:
+	- move() stores the distance as a magnitude and the direction separately, so the target, position and
+	  velocity never go negative except for the final tick of a ramp down, and direction tests are sign bit tests
+	- acceleration fits in 16 bits for every supported format (see setMaxAccel())
+	- idle axes return before any 32-bit arithmetic, and the move state is cleared once when a move starts
+	  instead of on every idle tick
+
+	No more than BurstCapX steps are sent in one tick.  Steps over the limit stay in MovePosnQx - StepsSent and go
+	out on the following ticks, and the move ends in state 5 until they have all been sent.
+	BurstCapX is normally MaxBurstX.  While the ClearPathStepGen is degraded after an overrun it is lower, and a ramp
+	does not advance while a full burst is held back, so the move is stretched in time rather than left behind.
+*/
+template<uint8_t FracBits>
+int ClearPathAxisState::calcStepsQ()
 {  
-	_TX++;//increment time
+	typedef ClearPathQ<32-FracBits, FracBits> Q;
+
 	if(!Enabled)
 		return 0;
 
 	// Process current move state.
 	switch(moveStateX){
-		case 3: // IdleState state, executed only once.
+		case 3: // IdleState state
 
-			if(CommandX == 0) //If no/finished command/, do nothing set everything to 0
-			{
-				MovePosnQx=0;
-				VelRefQx=0;
-				StepsSent=0;
-				_TX=0;
-				_TX1=0;
-				_TX2=0;
-				_TX3=0;
-				_BurstX=0;
-			}
-			else
-			{
-				// Compute Move parameters
-				TargetPosnQx = CommandX<<fractionalBits;
-				TriangleMovePeakQx = abs(TargetPosnQx>>1);
-				if(TargetPosnQx > 0)
-					AccelRefQxS = AccLimitQx;
-				else
-					AccelRefQxS = -AccLimitQx;
-				AccelRefQx = AccelRefQxS;
-				// Do immediate move if half move length <= maximum acceleration.
-				if(TriangleMovePeakQx <= AccLimitQx) {
-					AccelRefQx = 0;
-					VelRefQx = 0;
-					MovePosnQx = TargetPosnQx;
-					moveStateX = 3;	//Set to Move Idle
-					CommandX=0;		//Zero command
-					break;
-				}
-				// Otherwise, execute move and go to Phase1
-				MovePosnQx = MovePosnQx + VelRefQx;// + (AccelRefQx>>1);
-				VelRefQx = VelRefQx + AccelRefQx;
-				moveStateX = 1;
+			if(CommandX == 0) //If no/finished command/, there is nothing to send
+				return 0;
+
+			// Clear the previous move and compute Move parameters
+			MovePosnQx=0;
+			StepsSent=0;
+			_TX=1;
+			_TX1=0;
+			_TX2=0;
+			_TX3=0;
+			TargetPosnQx = Q::fromCounts(CommandX);
+			TriangleMovePeakQx = TargetPosnQx>>1;
+			_flag=false;
+			// The limits are taken once, a change during the move applies to the next one
+			MoveVelQx = VelLimitQx;
+			MoveAccQx = AccLimitQx;
+			// Do immediate move if half move length <= maximum acceleration.
+			if(TriangleMovePeakQx <= MoveAccQx) {
+				AccelRefQx = 0;
+				VelRefQx = 0;
+				MovePosnQx = TargetPosnQx;
+				moveStateX = 5;	//Finish once the steps are sent
+				break;
 			}
+			// Otherwise, execute move and go to Phase1
+			AccelRefQx = MoveAccQx;
+			VelRefQx = AccelRefQx;
+			moveStateX = 1;
 			break;
 
 		case 1:		//Phase 1 first half of move
-			
+			if(BurstCapX < MaxBurstX && Q::toCounts(MovePosnQx - StepsSent) >= BurstCapX)
+				break;		//Degraded, wait for the held back steps
+			_TX++;//increment time
+
 			// Execute move
-			MovePosnQx = MovePosnQx + VelRefQx + (AccelRefQx>>1);
-			VelRefQx = VelRefQx + AccelRefQx;
+			MovePosnQx += VelRefQx + (AccelRefQx>>1);
+			VelRefQx += AccelRefQx;
 
 			// Check position.
-			if(abs(MovePosnQx) >= TriangleMovePeakQx) {
+			if(MovePosnQx >= TargetPosnQx) {
+				// The extra tick past half can reach the target on a short, fast move, so end it there
+				AccelRefQx = 0;
+				VelRefQx = 0;
+				MovePosnQx = TargetPosnQx;
+				moveStateX = 5;
+			}
+			else if(MovePosnQx >= TriangleMovePeakQx) {
 				// If half move reached, compute time parameters and go to PXhase2
 
 				if(_flag)		//This makes sure you go one step past half in order to make sure Phase 2 goes well
@@ -129,84 +183,237 @@ int ClearPathMotorSD::calcSteps()
 				_flag=true;
 				
 			}
-			else {
-				// Otherwise, check velocity.
-				if(labs(VelRefQx) >= VelLimitQx) {
-					// If maximum velocity reached, compute TX1 and set AX = 0, and VelRefQx=VelLimitQx.
-					if(_TX1 == 0) {
-						AccelRefQx = 0;
-						_TX1 = _TX;
-						if(VelRefQx > 0)
-							VelRefQx=VelLimitQx;
-						else
-							VelRefQx=-VelLimitQx;
-					}
-				}
+			else if(_TX1 == 0 && VelRefQx >= MoveVelQx) {
+				// If maximum velocity reached, compute TX1 and set AX = 0, and VelRefQx=MoveVelQx.
+				AccelRefQx = 0;
+				_TX1 = _TX;
+				VelRefQx=MoveVelQx;
 			}
 			break;
 
 		case 2:		//Phase 2 2nd half of move
+			if(BurstCapX < MaxBurstX && Q::toCounts(MovePosnQx - StepsSent) >= BurstCapX)
+				break;		//Degraded, wait for the held back steps
+			_TX++;//increment time
+
 			// Execute move
-			MovePosnQx = MovePosnQx + VelRefQx + (AccelRefQx>>1);
-			VelRefQx = VelRefQx + AccelRefQx;
+			MovePosnQx += VelRefQx + (AccelRefQx>>1);
+			VelRefQx += AccelRefQx;
 
 			// Check time.
 			if(_TX >= _TX3) {
-				// If beyond TX3, wait for done condition.
-				AccelRefQx = -AccelRefQxS;
-				if((_TX > _TAUX) || (labs(MovePosnQx) > labs(TargetPosnQx)) || (VelRefQx*AccelRefQx > 0)) {
-            	// If done, enforce final position.
-					AccelRefQx = 0;
-					VelRefQx = 0;
-					MovePosnQx = TargetPosnQx;
-					moveStateX = 3;
-					CommandX=0;
+				// If beyond TX3, ramp down
+				AccelRefQx = -MoveAccQx;
+			}
+			// Wait for done condition: out of time, at the target, or the ramp down reversed
+			if((_TX >= _TX3 && (_TX > _TAUX || VelRefQx < 0)) || (MovePosnQx >= TargetPosnQx)) {
+				// If done, enforce final position.
+				AccelRefQx = 0;
+				VelRefQx = 0;
+				MovePosnQx = TargetPosnQx;
+				moveStateX = 5;
+			}
+			break;
+		case 4:		//Fast move, FastStepsX counts every tick with no ramp, see moveFast()
+			if(BurstCapX < MaxBurstX && Q::toCounts(MovePosnQx - StepsSent) >= BurstCapX)
+				break;		//Degraded, wait for the held back steps
+			{
+				// Whole counts only, so the move ends exactly on CommandX
+				long left = CommandX - Q::toCounts(MovePosnQx);
+				uint16_t steps = FastStepsX < BurstCapX ? FastStepsX : BurstCapX;
+				if(left <= steps) {
+					steps = left;
+					moveStateX = 5;
 				}
+				VelRefQx = moveStateX == 5 ? 0 : Q::fromCounts(steps);
+				MovePosnQx += Q::fromCounts(steps);
 			}
 			break;
-		case 4:		//Fast move case
-			// Execute move
-			TargetPosnQx = CommandX<<fractionalBits;
-				MovePosnQx = TargetPosnQx;
-			if(TargetPosnQx-MovePosnQx>50<<fractionalBits){
-				MovePosnQx=MovePosnQx+50<<fractionalBits;
+		case 5:		//Move finished, sending any steps held back by the burst limit
+			break;
+		case 6:		//Playing back a ClearPathBurstTable, see playMove()
+			if(BurstCapX < MaxBurstX && Q::toCounts(MovePosnQx - StepsSent) >= BurstCapX)
+				break;		//Degraded, wait for the held back steps
+			{
+				ClearPathBurstRun run = _table->run(_tableRun);
+				VelRefQx = Q::fromCounts(run.steps);
+				MovePosnQx += VelRefQx;
+				if(++_tableTick >= run.ticks) {
+					_tableTick = 0;
+					if(++_tableRun >= _table->runs()) {
+						VelRefQx = 0;
+						moveStateX = 5;
+					}
+				}
 			}
-			else{
-				MovePosnQx = TargetPosnQx;
-				CommandX=0;
-				moveStateX = 3;
+			break;
+#if CLEARPATH_SYNC_MOVES
+		case 7:		//Following the lead of a synchronized move, see ClearPathStepGen::moveSync()
+			{
+				// The lead is worked out first each tick, and this axis takes its share of the lead's position.
+				// Once the lead is done the axis is put exactly on its target, on the same tick.
+				int32_t posn = TargetPosnQx;
+				if(_lead->moveStateX != 5 && _lead->CommandX != 0) {
+					// The lead's position times SyncRatio, in two 16 bit halves so neither product overflows
+					uint32_t p = _lead->MovePosnQx;
+					posn = (p>>16)*SyncRatio + (((p&0xFFFF)*SyncRatio)>>16);
+					posn = SyncShift < 0 ? posn >> -SyncShift : posn << SyncShift;
+					if(posn > TargetPosnQx)
+						posn = TargetPosnQx;
+				}
+				else
+					moveStateX = 5;
+				VelRefQx = moveStateX == 5 ? 0 : posn - MovePosnQx;
+				MovePosnQx = posn;
 			}
-
 			break;
+#endif
+	}
+	// Compute burst value, anything over the limit is held back for the following ticks
+	int32_t burstX = Q::toCounts(MovePosnQx - StepsSent);
+	uint16_t cap = BurstCapX;
+#if CLEARPATH_SHAPER_TICKS
+	if(ShapeDelay1 && cap > 255)
+		cap = 255;		//The shaper's delay line holds a byte per tick
+#endif
+	if(burstX > cap) {
+		burstX = cap;
+		SaturatedTicks++;
 	}
-	// Compute burst value
-	_BurstX = (MovePosnQx - StepsSent)>>fractionalBits;
+	else if(burstX < 0)
+		burstX = 0;		//Never step backwards, the direction is only set by move()
 	// Update accumulated integer position
-	StepsSent += (long)(_BurstX)<<fractionalBits;
+	StepsSent += Q::fromCounts(burstX);
+#if CLEARPATH_SHAPER_TICKS
+	if(ShapeDelay1)
+		burstX = shapeSteps(burstX);
+#endif
+	_BurstX = burstX;
+	// The command is done once every step of the move has been sent
+	if(moveStateX == 5 && StepsSent >= MovePosnQx) {
+#if CLEARPATH_SHAPER_TICKS
+		if(ShapePending == 0)
+#endif
+		{
+			moveStateX = 3;
+			CommandX=0;
+		}
+	}
+
+	// Moves are kept within the soft limits when they are accepted, so this only acts when the limits or the
+	// position are changed during a move.  The move ends on the limit.
+	if(LimitOn && _BurstX) {
+		long room = _direction ? AbsPosition - LimitMin : LimitMax - AbsPosition;
+		if(room < (long)_BurstX) {
+			_BurstX = room > 0 ? room : 0;
+			VelRefQx = 0;
+			moveStateX = 3;
+			CommandX = 0;
+			clearShaper();
+			LimitStops++;
+		}
+	}
 
 	//check which direction, and incement absPosition
 	if(_direction)
-		AbsPosition+=_BurstX;
-	else
 		AbsPosition-=_BurstX;
+	else
+		AbsPosition+=_BurstX;
 	return _BurstX;
 
 }
 
+// calcStepsQ() is only built for the formats ClearPathMotorSDQ<> accepts
+template int ClearPathAxisState::calcStepsQ<8>();
+template int ClearPathAxisState::calcStepsQ<9>();
+template int ClearPathAxisState::calcStepsQ<10>();
+template int ClearPathAxisState::calcStepsQ<11>();
+template int ClearPathAxisState::calcStepsQ<12>();
+template int ClearPathAxisState::calcStepsQ<13>();
+template int ClearPathAxisState::calcStepsQ<14>();
+template int ClearPathAxisState::calcStepsQ<15>();
+template int ClearPathAxisState::calcStepsQ<16>();
 
-/*		
-	This is the default constructor.  This intializes the variables.
+#if CLEARPATH_BATCHED_AXES
+/*
+	This is the batched version of calcSteps() used by ClearPathStepGen with CLEARPATH_BATCHED_AXES.
+	It updates every axis in one pass over the contiguous state array, so the ISR makes a single call
+	per tick with the move math inlined into the loop.  It sends the same steps as calling calcSteps()
+	for each motor, whether it is also quicker has not been measured (see Examples/ISRBenchmark).
+	Only the axes in active are updated, and it returns the ones still busy afterwards.
 */
-ClearPathMotorSD::ClearPathMotorSD()
+uint8_t ClearPathAxisState::calcAll(ClearPathAxisState* axes, uint16_t* bursts, uint8_t numAxis, uint8_t active)
+{
+	for(uint8_t i=0;i<numAxis;i++)
+	{
+		uint8_t bit=1<<i;
+		if(active & bit)
+		{
+			bursts[i]=axes[i].calcStepsQ<10>();
+			if(!axes[i].busy())
+				active&=~bit;
+		}
+		else
+			bursts[i]=0;
+	}
+	return active;
+}
+#endif
+
+#if CLEARPATH_SHAPER_TICKS
+/*
+	This is the input shaper.  It takes the steps the move calculations made this tick, and returns the steps
+	to send: the sum of this tick's steps times ShapeA0, and the steps ShapeDelay1 and ShapeDelay2 ticks ago
+	times ShapeA1 and ShapeA2.  The fractions are carried in ShapeAcc, and as the impulses add up to exactly
+	one the move sends every one of its steps, ShapeDelay2 (or ShapeDelay1) ticks after the move calculations
+	finish.  No tick sends more than the most steps of any tick in the delay line, so the burst limit holds.
+*/
+uint16_t ClearPathAxisState::shapeSteps(uint8_t steps)
+{
+	uint8_t head = ShapeHead;
+	ShapeBuf[head] = steps;
+	uint8_t i = head >= ShapeDelay1 ? head - ShapeDelay1 : head + CLEARPATH_SHAPER_TICKS - ShapeDelay1;
+	uint32_t acc = ShapeAcc + (uint32_t)ShapeA0 * steps + (uint32_t)ShapeA1 * ShapeBuf[i];
+	if(ShapeDelay2) {
+		i = head >= ShapeDelay2 ? head - ShapeDelay2 : head + CLEARPATH_SHAPER_TICKS - ShapeDelay2;
+		acc += (uint32_t)ShapeA2 * ShapeBuf[i];
+	}
+	if(++head >= CLEARPATH_SHAPER_TICKS)
+		head = 0;
+	ShapeHead = head;
+	uint16_t out = acc >> 16;
+	ShapeAcc = acc;
+	ShapePending += steps;
+	ShapePending -= out;
+	return out;
+}
+#endif
+
+/*
+	This empties the input shaper's delay line, dropping any steps still in it.
+*/
+void ClearPathAxisState::clearShaper()
+{
+#if CLEARPATH_SHAPER_TICKS
+	for(uint8_t i=0;i<CLEARPATH_SHAPER_TICKS;i++)
+		ShapeBuf[i]=0;
+	ShapeHead=0;
+	ShapeAcc=0;
+	ShapePending=0;
+#endif
+}
+
+/*
+	This puts the axis in the move idle state with no command, no limits and a zero position.
+*/
+void ClearPathAxisState::reset()
 {
 	moveStateX=3;
-	PinA=0;
-	PinB=0;
-	PinE=0;
-	PinH=0;
 	Enabled=false;
 	VelLimitQx=0;					
 	AccLimitQx=0;
+	MoveVelQx=0;
+	MoveAccQx=0;
 	MovePosnQx=0;				
 	StepsSent=0;				
 	VelRefQx=0;				
@@ -217,15 +424,61 @@ ClearPathMotorSD::ClearPathMotorSD()
 	_TX3=0;			
 	_TAUX=0;					
 	_flag=0;
-	AccelRefQxS=0;					
 	TargetPosnQx=0;				
 	TriangleMovePeakQx=0;					
 	CommandX=0;
-	fractionalBits=10;
+	_table=0;
+	_tableRun=0;
+	_tableTick=0;
+#if CLEARPATH_SYNC_MOVES
+	_lead=0;
+	SyncRatio=0;
+	SyncShift=0;
+#endif
+	_direction=false;
 	_BurstX=0;
+	MaxBurstX=255;
+	BurstCapX=255;
+	FastStepsX=50;
+#if CLEARPATH_SHAPER_TICKS
+	ShapeDelay1=0;
+	ShapeDelay2=0;
+	ShapeA0=0;
+	ShapeA1=0;
+	ShapeA2=0;
+#endif
+	clearShaper();
+	SaturatedTicks=0;
+	LimitOn=false;
+	LimitMin=0;
+	LimitMax=0;
+	LimitStops=0;
 	AbsPosition=0;
 }
 
+/*		
+	This is the default constructor.  This intializes the variables.
+	With CLEARPATH_BATCHED_AXES the move state is initialized when the motor is passed to a ClearPathStepGen.
+*/
+ClearPathMotorSD::ClearPathMotorSD()
+{
+	PinA=0;
+	PinB=0;
+	PinE=0;
+	PinH=0;
+	fractionalBits=10;
+	_stepGen=0;
+	_axisBit=0;
+	_velMax=0;
+	_accelMax=0;
+	_limitClip=false;
+#if CLEARPATH_BATCHED_AXES
+	_axis=0;
+#else
+	reset();
+#endif
+}
+
 /*		
 	This is the one pin attach function.  It asociates the passed number, as this motors Step Pin
 */
@@ -297,40 +550,45 @@ void ClearPathMotorSD::attach(int APin, int BPin, int EPin, int HPin)
 */
 void ClearPathMotorSD::stopMove()
 {
+	ClearPathAxisState& a = axis();
 	cli();
-	MovePosnQx=0;
-	VelRefQx=0;
-	StepsSent=0;
-	_TX=0;
-	_TX1=0;
-	_TX2=0;
-	_TX3=0;
-	_BurstX=0;
-	moveStateX = 3;
-	CommandX=0;
+	a.MovePosnQx=0;
+	a.VelRefQx=0;
+	a.StepsSent=0;
+	a._TX=0;
+	a._TX1=0;
+	a._TX2=0;
+	a._TX3=0;
+	a._BurstX=0;
+	a.clearShaper();
+	a.moveStateX = 3;
+	a.CommandX=0;
 	sei();
 }
 
 /*		
 	This function commands a directional move
-	The move cannot be longer than 2,000,000 counts
+	The move cannot be longer than CLEARPATH_MAX_MOVE() counts for the motor's format (2,097,100 in Q22.10),
+	a longer move is rejected
 	If there is a current move, it will NOT be overwritten
+	A move past a soft limit is rejected, or clipped to the limit, see setSoftLimits()
 
 	The function will return true if the move was accepted
 */
 boolean ClearPathMotorSD::move(long dist)
 {
-  if(CommandX==0)
+  if(commandDone() && fitsMove(dist) && limitMove(dist))
   {
+	  ClearPathAxisState& a = axis();
 	  if(dist<0)
 	  {
 		  if(PinA!=0)
 		  {
 			  digitalWrite(PinA,HIGH);
 			  delay(1);
-			  _direction=true;
 		  }
-		  CommandX=-dist;
+		  a._direction=true;
+		  a.CommandX=-dist;
 	  }
 	  else
 	  {
@@ -338,10 +596,12 @@ boolean ClearPathMotorSD::move(long dist)
 		  {
 			  digitalWrite(PinA,LOW);
 			  delay(1);
-			  _direction=false;
 		  }
-			CommandX=dist;
+		  a._direction=false;
+			a.CommandX=dist;
 	  }
+	  if(_stepGen)
+		  _stepGen->activate(_axisBit);
 	  return true;
   }
   else
@@ -349,82 +609,460 @@ boolean ClearPathMotorSD::move(long dist)
 
 }
 
+/*
+	This function commands a move to an absolute position, in counts of the commanded position (see setPosition()).
+	The distance is worked out from the commanded position while the motor has no command, so no step lands between
+	the two and a run of moveTo() calls never drifts.
+	If there is a current move, it will NOT be overwritten
+	A move past a soft limit is rejected, or clipped to the limit, see setSoftLimits()
+
+	The function will return true if the move was accepted
+*/
+boolean ClearPathMotorSD::moveTo(long position)
+{
+	if(!commandDone())
+		return false;
+	return move(position-getCommandedPosition());
+}
+
 /*		
-	This function commands a directional move which will burst out steps as fast as possible with no acceleration or velocity limits
+	This function commands a directional move which sends the same number of steps on every tick, with no acceleration
+	ramp, until the last tick sends whatever is left.  The steps per tick are set by setFastStepsPerTick() (default 50),
+	and are still limited to the maximum steps per tick, see setMaxStepsPerTick()
+	The move cannot be longer than move() accepts
+	If there is a current move, it will NOT be overwritten
+	A move past a soft limit is rejected, or clipped to the limit, see setSoftLimits()
+
+	The function will return true if the move was accepted
 */
 boolean ClearPathMotorSD::moveFast(long dist)
 {
-  if(CommandX==0)
+  if(commandDone() && fitsMove(dist) && limitMove(dist))
   {
-	  if(dist<0)
-	  {
-		  if(PinA!=0)
-		  {
-			  digitalWrite(PinA,HIGH);
-			  _direction=true;
-		  }
-		  cli();
-		  moveStateX = 4;
-		  CommandX=-dist;
-		  sei();
-		  
-	  }
-	  else
+	  ClearPathAxisState& a = axis();
+	  if(PinA!=0)
+		  digitalWrite(PinA, dist<0 ? HIGH : LOW);
+	  a._direction= dist<0;
+	  cli();
+	  a.MovePosnQx=0;
+	  a.StepsSent=0;
+	  a.VelRefQx=0;
+	  a.CommandX= dist<0 ? -dist : dist;
+	  a.moveStateX= a.CommandX ? 4 : 3;
+	  sei();
+	  if(_stepGen)
+		  _stepGen->activate(_axisBit);
+	  return true;
+  }
+  else
+	  return false;
+
+}
+/*
+	This function works out a move of dist counts with the motor's current velocity, acceleration and steps per tick
+	limits and stores the steps of every tick in table, exactly as calcSteps() would send them.  The motor does not
+	move.  It runs the whole move at once, so it takes about as long as the ISR would spend on the move's ticks.
+	It returns false, and leaves the table empty, if the table is in flash, a tick needs more than 255 steps, or the
+	move does not fit in the table or is longer than move() accepts.
+*/
+boolean ClearPathMotorSD::recordMove(ClearPathBurstTable& table, long dist)
+{
+	if(table._flash)
+		return false;
+	table.clear();
+	if(!fitsMove(dist))
+		return false;
+
+	//Work the move out on a copy of the motor's state
+	ClearPathAxisState sim = axis();
+	sim.Enabled=true;
+	sim.moveStateX=3;
+	sim.CommandX= dist<0 ? -dist : dist;
+	sim._direction= dist<0;
+	sim.BurstCapX=sim.MaxBurstX;
+	sim.LimitOn=false;		//The soft limits apply where the table is played, see playMove()
+#if CLEARPATH_SHAPER_TICKS
+	sim.ShapeDelay1=0;		//The table holds the move unshaped, the shaper is applied as it is played
+#endif
+
+	uint16_t n=0;
+	ClearPathBurstRun run = {0, 0};
+	while(sim.busy())
+	{
+		int steps=calcStepsFor(sim);
+		if(steps>255)
+			return false;
+		if(run.ticks!=0 && run.steps==steps && run.ticks<255)
+			run.ticks++;
+		else
+		{
+			if(run.ticks!=0)
+			{
+				if(n==table._maxRuns)
+					return false;
+				table._ram[n++]=run;
+			}
+			run.steps=steps;
+			run.ticks=1;
+		}
+	}
+	if(run.ticks!=0)
+	{
+		if(n==table._maxRuns)
+			return false;
+		table._ram[n++]=run;
+	}
+
+	table._numRuns=n;
+	table._dist=dist;
+	table._velMax=_velMax;
+	table._accelMax=_accelMax;
+	table._maxBurst=sim.MaxBurstX;
+	table._tickHz=tickHz();
+	table._fractionalBits=fractionalBits;
+	return true;
+}
+
+/*
+	This function commands the move stored in table.  Each tick the ISR sends the next entry of the table instead of
+	working the move out, the steps per tick limit still applies.  The table must not change until the move is done.
+	If there is a current move, it will NOT be overwritten
+	A move past a soft limit is rejected, a table is never clipped, see setSoftLimits()
+	A table whose runs add up to no distance moves nothing and leaves the motor idle, as moveFast(0) does
+
+	The function will return true if the move was accepted
+*/
+boolean ClearPathMotorSD::playMove(const ClearPathBurstTable& table)
+{
+  long dist=table.distance();
+  long limited=dist;
+  if(commandDone() && table.runs()!=0 && limitMove(limited) && limited==dist)		//A table cannot be clipped
+  {
+	  ClearPathAxisState& a = axis();
+	  if(PinA!=0)
 	  {
-		  if(PinA!=0)
-		  {
-			  digitalWrite(PinA,LOW);
-			  _direction=false;
-		  }
-			cli();
-			moveStateX = 4;
-			CommandX=dist;
-			sei();
+		  digitalWrite(PinA, dist<0 ? HIGH : LOW);
+		  delay(1);
 	  }
+	  a._direction= dist<0;
+	  cli();
+	  a._table=&table;
+	  a._tableRun=0;
+	  a._tableTick=0;
+	  a.MovePosnQx=0;
+	  a.StepsSent=0;
+	  a.CommandX= dist<0 ? -dist : dist;
+	  a.moveStateX= a.CommandX ? 6 : 3;		//A table of no distance is done at once, as moveFast(0)
+	  sei();
+	  if(_stepGen)
+		  _stepGen->activate(_axisBit);
 	  return true;
   }
   else
 	  return false;
+}
+
+/*
+	This function commands a move of dist counts, playing it from table if the table was recorded for this move
+	with the motor's current velocity, acceleration, steps per tick and tick rate.  Otherwise the move is recorded
+	into the table first, replacing what it held, and if it does not fit it is made with move() instead.
+	Give each move which is repeated its own table.
 
+	The function will return true if the move was accepted
+*/
+boolean ClearPathMotorSD::moveCached(ClearPathBurstTable& table, long dist)
+{
+	if(!commandDone())
+		return false;
+	ClearPathAxisState& a = axis();
+	if(table.runs()==0 || table._dist!=dist || table._velMax!=_velMax || table._accelMax!=_accelMax
+		|| table._maxBurst!=a.MaxBurstX || table._tickHz!=tickHz() || table._fractionalBits!=fractionalBits)
+	{
+		if(!recordMove(table, dist))
+			return move(dist);
+	}
+	return playMove(table);
 }
-/*		
-	This function sets the velocity in Counts/sec assuming the ISR frequency is 2kHz.
-	The maximum value for velMax is 100,000, the minimum is 2
+
+/*
+	This function returns value*2^shift/hz, rounded toward zero, without the product overflowing 32 bits.
+	It converts a per second value to the motor's format per tick, exactly as a single division would.
 */
-void ClearPathMotorSD::setMaxVel(long velMax)
+static long scaleToTick(long value, uint8_t shift, uint16_t hz)
+{
+	unsigned long v = value<0 ? -value : value;
+	unsigned long scaled = ((v/hz)<<shift) + (((v%hz)<<shift)/hz);
+	return value<0 ? -(long)scaled : (long)scaled;
+}
+
+/*
+	This function returns the tick rate of the step generator this motor is attached to
+*/
+uint16_t ClearPathMotorSD::tickHz()
+{
+	return _stepGen ? _stepGen->_tickHz : CLEARPATH_TICK_HZ;
+}
+
+/*
+	This function returns a velocity in Counts/sec as the velocity limit the ISR uses, per tick in the motor's format
+*/
+int32_t ClearPathMotorSD::velLimitQx(long velMax)
 {
-	int n = velMax/2000;
+	uint16_t hz = tickHz();
+	long n = velMax/hz;
 	if(n<51)
-		VelLimitQx=(velMax*(1<<fractionalBits))/2000;
+		return scaleToTick(velMax, fractionalBits, hz);	// velMax/hz in the motor's format
 	else
-		VelLimitQx=50*(1<<fractionalBits);
+		return 50L<<fractionalBits;
+}
 
+/*
+	This function returns an acceleration in Counts/sec/sec as the acceleration limit the ISR uses, per tick per tick
+	in the motor's format.  It is kept to 16 bits, so it is clipped to 32767: see setMaxAccel() for when that happens.
+*/
+int16_t ClearPathMotorSD::accLimitQx(long accelMax)
+{
+  uint16_t hz = tickHz();
+  if(accelMax>2000000)
+	  accelMax=2000000;
+  long accelQx=scaleToTick(accelMax, fractionalBits, hz)/hz;	// accelMax/hz^2 in the motor's format
+  if(accelQx>32767)
+	  accelQx=32767;
+  return accelQx;
 }
+
 /*		
-	This function sets the acceleration in Counts/sec/sec assuming the ISR frequency is 2kHz.
+	This function sets the velocity in Counts/sec at the tick rate of the motor's step generator (2kHz by default).
+	The maximum value for velMax is 50 counts per tick (100,000 at 2kHz), the minimum is 2
+*/
+void ClearPathMotorSD::setMaxVel(long velMax)
+{
+	ClearPathAxisState& a = axis();
+	_velMax = velMax;
+	a.VelLimitQx=velLimitQx(velMax);
+
+}
+/*		
+	This function sets the acceleration in Counts/sec/sec at the tick rate of the motor's step generator (2kHz by default).
 	The maximum value for accelMax is 2,000,000, the minimum is 4,000
+	The acceleration per tick per tick must also fit in 16 bits of the motor's format, which holds every accelMax below
+	32768 * tickHz^2 / 2^FracBits.  At 2kHz that is all of them up to Q17.15 and all but 2,000,000 itself in Q16.16,
+	at slower ticks it is less, ie: below 500,000 in Q18.14 at 500Hz.  A higher accelMax is reduced to the most that fits.
+
+	The function will return false if accelMax was reduced, the reduced acceleration is still set
+*/
+boolean ClearPathMotorSD::setMaxAccel(long accelMax)
+{
+  ClearPathAxisState& a = axis();
+  uint16_t hz = tickHz();
+  _accelMax = accelMax;
+  a.AccLimitQx=accLimitQx(accelMax);
+  return accelMax<=2000000 && scaleToTick(accelMax, fractionalBits, hz)/hz<=32767;
+}
+
+
+/*
+	This function sets the most steps the motor may be sent in one tick of the ISR, from 1 to 32,767 (default 255).
+	When a move asks for more, the extra steps are sent on the following ticks and the tick is counted as saturated.
+	Each step takes a few microseconds of the ISR, so large values must leave room for the other axes in the 500us tick.
+*/
+void ClearPathMotorSD::setMaxStepsPerTick(uint16_t maxSteps)
+{
+	ClearPathAxisState& a = axis();
+	if(maxSteps<1)
+		maxSteps=1;
+	if(maxSteps>32767)
+		maxSteps=32767;
+	cli();
+	if(a.BurstCapX==a.MaxBurstX || a.BurstCapX>maxSteps)
+		a.BurstCapX=maxSteps;		//Keep any lower cap set by a degraded ClearPathStepGen
+	a.MaxBurstX=maxSteps;
+	sei();
+}
+
+/*
+	This function sets the steps moveFast() sends on every tick, from 1 to 32,767 (default 50, the most setMaxVel() allows).
+	The maximum steps per tick set by setMaxStepsPerTick() still applies.  A moveFast() already running changes to the new rate on the next tick.
+*/
+void ClearPathMotorSD::setFastStepsPerTick(uint16_t steps)
+{
+	ClearPathAxisState& a = axis();
+	if(steps<1)
+		steps=1;
+	if(steps>32767)
+		steps=32767;
+	a.FastStepsX=steps;
+}
+
+/*
+	This function sets an input shaper on the motor's steps, to cancel the ringing of a machine at freqHz, the
+	frequency it rings at after a move, with damping its damping ratio (0 to 0.99, 0.05 is typical of a frame).
+	Each move is split into two (CLEARPATH_SHAPER_ZV) or three (CLEARPATH_SHAPER_ZVD) copies of itself half a
+	ringing period apart, sized so the ringing each starts cancels.  Moves take half a period (ZV) or a whole period
+	(ZVD) longer, but can use a higher acceleration for the same settling time.  ZVD still works when freqHz is
+	off by around 20%, ZV only by around 5%.  CLEARPATH_SHAPER_OFF turns the shaper off.
+	It must be set while the motor has no command, after the step generator's tick rate is set, and needs
+	CLEARPATH_SHAPER_TICKS in ClearPathConfig.h to be longer than the delay, see there.
+
+	The function will return true if the shaper was set
 */
-void ClearPathMotorSD::setMaxAccel(long accelMax)
+boolean ClearPathMotorSD::setShaper(uint8_t type, float freqHz, float damping)
 {
-  AccLimitQx=(accelMax*(1<<fractionalBits))/4000000;
+	if(!commandDone())
+		return false;
+#if CLEARPATH_SHAPER_TICKS
+	ClearPathAxisState& a = axis();
+	uint8_t delay1=0;
+	uint8_t delay2=0;
+	uint16_t a1=0;
+	uint16_t a2=0;
+	if(type!=CLEARPATH_SHAPER_OFF)
+	{
+		if(freqHz<=0 || damping<0 || damping>=1 || type>CLEARPATH_SHAPER_ZVD)
+			return false;
+		float halfPeriod=tickHz()/(2*freqHz);	// in ticks
+		float periods= type==CLEARPATH_SHAPER_ZVD ? 2 : 1;
+		if(halfPeriod*periods+0.5>CLEARPATH_SHAPER_TICKS-1 || halfPeriod<0.5)
+			return false;
+		float k=exp(-damping*PI/sqrt(1-damping*damping));
+		delay1=halfPeriod+0.5;
+		if(type==CLEARPATH_SHAPER_ZVD)
+		{
+			delay2=halfPeriod*2+0.5;
+			a1=65536*2*k/((1+k)*(1+k))+0.5;
+			a2=65536*k*k/((1+k)*(1+k))+0.5;
+		}
+		else
+			a1=65536*k/(1+k)+0.5;
+	}
+	cli();
+	a.clearShaper();
+	a.ShapeDelay1=delay1;
+	a.ShapeDelay2=delay2;
+	a.ShapeA1=a1;
+	a.ShapeA2=a2;
+	a.ShapeA0= delay1 ? 65536UL-a1-a2 : 0;
+	sei();
+	return true;
+#else
+	(void)freqHz;		//There is no delay line to shape with
+	(void)damping;
+	return type==CLEARPATH_SHAPER_OFF;
+#endif
 }
 
+/*
+	This function returns how many ticks had their burst cut short by the maximum steps per tick
+*/
+unsigned long ClearPathMotorSD::getSaturatedTicks()
+{
+	ClearPathAxisState& a = axis();
+	cli();
+	unsigned long count=a.SaturatedTicks;
+	sei();
+	return count;
+}
+
+/*
+	This function sets the commanded position to position, without moving the motor, ie: 0 makes where the motor is
+	the new origin.  It can be called during a move, which carries on from the new position.  The position is kept
+	through disable() and enable().
+*/
+void ClearPathMotorSD::setPosition(long position)
+{
+	ClearPathAxisState& a = axis();
+	cli();
+	a.AbsPosition=position;
+	sei();
+}
+
+/*
+	This function sets soft limits on the commanded position: every move accepted from then on must end between
+	minPos and maxPos.  A move which would not is rejected, or with clip set shortened to end on the limit.
+	A motor outside the limits may still move back towards them.  The limits are checked once when a move is accepted,
+	so they cost nothing while it runs.  If the limits or the position (see setPosition()) are changed during a move,
+	the ISR ends the move on the limit instead, abruptly, and getLimitStops() counts it.
+	A move played from a ClearPathBurstTable is never clipped, only rejected.
+*/
+void ClearPathMotorSD::setSoftLimits(long minPos, long maxPos, boolean clip)
+{
+	ClearPathAxisState& a = axis();
+	_limitClip=clip;
+	cli();
+	a.LimitMin=minPos;
+	a.LimitMax=maxPos;
+	a.LimitOn=true;
+	sei();
+}
+
+/*
+	This function removes the soft limits
+*/
+void ClearPathMotorSD::clearSoftLimits()
+{
+	ClearPathAxisState& a = axis();
+	a.LimitOn=false;
+}
+
+/*
+	This function returns how many moves the ISR ended at a soft limit, see setSoftLimits()
+*/
+unsigned long ClearPathMotorSD::getLimitStops()
+{
+	ClearPathAxisState& a = axis();
+	cli();
+	unsigned long count=a.LimitStops;
+	sei();
+	return count;
+}
+
+/*
+	This function checks a move of dist counts from the commanded position against the soft limits, for a motor
+	with no command.  It returns false if the move would end past a limit and moves are rejected, otherwise it
+	shortens dist to end on the limit (0 if the motor is already past it) and returns true.
+*/
+boolean ClearPathMotorSD::limitMove(long& dist)
+{
+	ClearPathAxisState& a = axis();
+	if(!a.LimitOn)
+		return true;
+	long pos=getCommandedPosition();
+	long clipped;
+	if(dist>0 && pos+dist>a.LimitMax)
+		clipped= pos<a.LimitMax ? a.LimitMax-pos : 0;
+	else if(dist<0 && pos+dist<a.LimitMin)
+		clipped= pos>a.LimitMin ? a.LimitMin-pos : 0;
+	else
+		return true;
+	if(!_limitClip)
+		return false;
+	dist=clipped;
+	return true;
+}
 
 /*		
-	This function returns the absolute commanded position
+	This function returns the absolute commanded position, counting up for positive moves from the position set by
+	setPosition() (0 until it is called)
 */
 long ClearPathMotorSD::getCommandedPosition()
 {
-	return AbsPosition;
+	ClearPathAxisState& a = axis();
+	long pos;
+	do
+		pos=a.AbsPosition;		//The ISR may update the 4 bytes part way through a read, so read until it holds still
+	while(pos!=a.AbsPosition);
+	return pos;
 }
 
 /*		
 	This function returns true if there is no current command
-	It returns false if there is a current command
+	It returns false if there is a current command, or steps of the last one planned ahead or spread over the last
+	tick are still to be sent
 */
 boolean ClearPathMotorSD::commandDone()
 {
-	if(CommandX==0)
+	ClearPathAxisState& a = axis();
+	if(a.CommandX==0 && !(_stepGen && _stepGen->queued(_axisBit)))
 		return true;
 	else
 		return false;
@@ -443,15 +1081,15 @@ boolean ClearPathMotorSD::readHLFB()
 }
 
 /*		
-	This function enables the motor
+	This function enables the motor.  The commanded position is kept, use setPosition() to change it
 */
 void ClearPathMotorSD::enable()
 {
+	ClearPathAxisState& a = axis();
 
 	if(PinE!=0)
 		digitalWrite(PinE,HIGH);
-	AbsPosition=0;
-	Enabled=true;
+	a.Enabled=true;
 }
 
 /*		
@@ -460,9 +1098,10 @@ void ClearPathMotorSD::enable()
 */
 void ClearPathMotorSD::disable()
 {
+	ClearPathAxisState& a = axis();
 	stopMove();
 	if(PinE!=0)
 		digitalWrite(PinE,LOW);
-	Enabled=false;
+	a.Enabled=false;
 	
 }
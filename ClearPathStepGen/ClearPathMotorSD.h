@@ -35,21 +35,154 @@
 
    enable() - enables the motor
 
-   getCommandedPosition() - Returns the absolute cmomanded position where the position on enable=0
+   getCommandedPosition() - Returns the absolute cmomanded position, 0 until setPosition() is called
+
+   setPosition() - sets the commanded position to a value, ie: 0 to re-zero the motor where it is
+
+   moveTo() - moves to an absolute position, the distance is worked out from the commanded position
+
+   setSoftLimits() - sets the range of commanded positions moves are kept within, rejecting or clipping those that leave it
+
+   clearSoftLimits() - removes the soft limits
+
+   getLimitStops() - returns how many moves the ISR stopped at a soft limit
 
    readHLFB() - Returns the value of the motor's HLFB Pin
 
    setMaxVel() - sets the maximum veloctiy
 
-   setMaxAccel() - sets the acceleration
+   setMaxAccel() - sets the acceleration, returns false if it had to be reduced to fit
+
+   setMaxStepsPerTick() - sets the most steps sent in one tick, extra steps are sent on the following ticks
+
+   getSaturatedTicks() - returns how many ticks were limited by setMaxStepsPerTick()
+
+   setFastStepsPerTick() - sets the steps moveFast() sends on every tick
+
+   setShaper() - shapes the motor's steps with a ZV or ZVD input shaper to cancel ringing at a frequency
 
    commandDone() - returns wheter or not there is a valid current command
+
+   recordMove() - works out a move and stores the steps of each tick in a ClearPathBurstTable, without moving
+
+   playMove() - makes the move stored in a ClearPathBurstTable, reading its steps from the table each tick
+
+   moveCached() - plays a move from a ClearPathBurstTable, recording it first if the table holds a different move
+
+  Positions, velocities and accelerations are tracked in Q22.10 fixed point by default.  A motor which needs
+  finer velocity resolution (ie: a slow axis) can be declared with a different format at compile time:
+
+   ClearPathMotorSDQ<14> Slow;	// Q18.14, moves up to 131,020 counts
+
+  ClearPathMotorSDQ<> takes the number of fractional bits (8-16) and is used exactly like a ClearPathMotorSD.
+  The longest move is CLEARPATH_MAX_MOVE(FracBits) counts (see ClearPathFixed.h), 2,097,100 in Q22.10 and 32,716
+  in Q16.16, and a longer one is rejected.
    
  */
 #ifndef ClearPathMotorSD_h
 #define ClearPathMotorSD_h
 #include "Arduino.h"
-class ClearPathMotorSD
+#include "ClearPathConfig.h"
+#include "ClearPathFixed.h"
+#include "ClearPathBurstTable.h"
+
+class ClearPathStepGen;
+
+// Input shapers for ClearPathMotorSD::setShaper()
+#define CLEARPATH_SHAPER_OFF 0
+#define CLEARPATH_SHAPER_ZV 1		// Two impulses half a period apart, cancels one frequency
+#define CLEARPATH_SHAPER_ZVD 2		// Three impulses over a period, cancels a wider band around it
+
+/*
+	ClearPathAxisState holds everything the ISR reads or writes for one motor.
+	Normally every ClearPathMotorSD carries its own, with CLEARPATH_BATCHED_AXES the ClearPathStepGen
+	keeps one contiguous array of them for all of its motors (see ClearPathConfig.h).
+*/
+class ClearPathAxisState
+{
+  public:
+  boolean Enabled; 
+ int moveStateX;
+  volatile long AbsPosition;
+
+  void reset();
+  template<uint8_t FracBits> int calcStepsQ();
+  int32_t velocityQx() { return _direction ? -VelRefQx : VelRefQx; }	// Velocity with the same sign as AbsPosition
+  void capBurst(uint16_t cap) { BurstCapX = (cap && cap < MaxBurstX) ? cap : MaxBurstX; }	// 0 lifts the cap
+  boolean busy() { return CommandX!=0; }		// True until the current command has been sent
+  boolean saturated() { return _BurstX>=BurstCapX; }	// True if the last burst was cut short by the cap
+  void clearShaper();
+#if CLEARPATH_BATCHED_AXES
+  static uint8_t calcAll(ClearPathAxisState* axes, uint16_t* bursts, uint8_t numAxis, uint8_t active);
+#endif
+  
+  protected:
+  friend class ClearPathMotorSD;
+  friend class ClearPathStepGen;
+  volatile long CommandX;
+  const ClearPathBurstTable* _table;		// Table being played back in move state 6...
+  uint16_t _tableRun;						// ...the run being sent...
+  uint8_t _tableTick;						// ...and the ticks of it already sent
+  boolean _direction;
+  uint16_t _BurstX;						// Steps sent on the last tick
+  uint16_t MaxBurstX;						// Most steps that may be sent in one tick
+  uint16_t BurstCapX;						// Limit in effect, below MaxBurstX while the step generator is degraded
+  uint16_t FastStepsX;					// Steps sent on each tick of a moveFast()
+  volatile unsigned long SaturatedTicks;	// Ticks which were cut short by BurstCapX
+  boolean LimitOn;						// Soft limits on the commanded position, see setSoftLimits()
+  long LimitMin;
+  long LimitMax;
+  volatile unsigned long LimitStops;		// Moves the ISR ended at a soft limit
+#if CLEARPATH_SYNC_MOVES
+  const ClearPathAxisState* _lead;		// Move followed in move state 7, see ClearPathStepGen::moveSync()...
+  uint32_t SyncRatio;						// ...this axis' distance over the lead's in Q0.16, 65536 for the longest...
+  int8_t SyncShift;						// ...and this axis' fractional bits less the lead's
+#endif
+#if CLEARPATH_SHAPER_TICKS
+  // Input shaper, the steps sent are the steps of the move convolved with up to three impulses
+  uint16_t shapeSteps(uint8_t steps);
+  uint8_t ShapeBuf[CLEARPATH_SHAPER_TICKS];	// Steps of the move on the last ticks
+  uint8_t ShapeHead;						// Entry for this tick
+  uint8_t ShapeDelay1;					// Ticks to the second and third impulses, 0 with the shaper off...
+  uint8_t ShapeDelay2;					// ...and 0 for a ZV shaper
+  uint16_t ShapeA0;						// Impulse sizes in Q0.16, adding up to exactly 65536
+  uint16_t ShapeA1;
+  uint16_t ShapeA2;
+  uint16_t ShapeAcc;						// Fraction of a step carried to the next tick
+  uint16_t ShapePending;					// Steps of the move not sent yet
+#endif
+
+// All of the position, velocity and acceleration parameters are signed and in the motor's ClearPathQ format
+// (Q22.10 unless declared as a ClearPathMotorSDQ<>), with all arithmetic performed in fixed point.
+// They are measured from the start of the current move in the direction of the move, so they are only
+// negative on the last tick of a ramp down.
+
+ int32_t VelLimitQx;					// Velocity limit
+ int16_t AccLimitQx;					// Acceleration limit, at most 32767 (see ClearPathMotorSD::setMaxAccel())
+ int32_t MoveVelQx;					// Limits of the current move, taken from the two above when it starts
+ int16_t MoveAccQx;
+ int32_t MovePosnQx;					// Current position
+ int32_t StepsSent;				// Accumulated integer position
+ int32_t VelRefQx;					// Current velocity
+ int16_t AccelRefQx;					// Current acceleration
+ long _TX;					// Current time
+ long _TX1;				// End of ramp up time
+ long _TX2;				// Beginning of phase 2 time
+ long _TX3;				// Beginning of ramp down time
+ long _TAUX;					// Integer burst value
+ boolean _flag;
+ int32_t TargetPosnQx;						// Move length
+ int32_t TriangleMovePeakQx;	
+
+};
+
+#if CLEARPATH_BATCHED_AXES
+struct ClearPathMotorSDStorage {};		// The axis state is kept by the ClearPathStepGen
+#else
+typedef ClearPathAxisState ClearPathMotorSDStorage;
+#endif
+
+class ClearPathMotorSD : public ClearPathMotorSDStorage
 {
   public:
   ClearPathMotorSD();
@@ -59,49 +192,76 @@ class ClearPathMotorSD
   void attach(int, int, int, int);
   boolean move(long);
   boolean moveFast(long);
+  boolean moveTo(long);
+  void setPosition(long);
+  void setSoftLimits(long, long, boolean=false);
+  void clearSoftLimits();
+  unsigned long getLimitStops();
   void enable();
   long getCommandedPosition();
   boolean readHLFB();
   void stopMove();
-  int calcSteps();
+  virtual int calcSteps();
   void setMaxVel(long); 
-  void setMaxAccel(long);
+  boolean setMaxAccel(long);
+  void setMaxStepsPerTick(uint16_t);
+  void setFastStepsPerTick(uint16_t);
+  boolean setShaper(uint8_t, float, float);
+  unsigned long getSaturatedTicks();
   boolean commandDone();
   void disable();
+  boolean recordMove(ClearPathBurstTable&, long);
+  boolean playMove(const ClearPathBurstTable&);
+  boolean moveCached(ClearPathBurstTable&, long);
 
   
   uint8_t PinA;
   uint8_t PinB;
   uint8_t PinE;
   uint8_t PinH;
-  boolean Enabled; 
- int moveStateX;
-  volatile long AbsPosition;
   
-  private:
-  volatile long CommandX;
-  boolean _direction;
-  uint8_t _BurstX;
+  protected:
+  friend class ClearPathStepGen;
+  uint8_t fractionalBits;					// Fractional bits of the format, only used outside of the ISR
+  ClearPathStepGen* _stepGen;				// The step generator this motor is attached to, 0 until attached to one
+  uint8_t _axisBit;						// This motor's bit in that step generator's active axes
+  long _velMax;							// Limits as last set, converted again if the tick rate changes
+  long _accelMax;
+  boolean _limitClip;						// Moves past a soft limit are clipped to it, instead of rejected
+  boolean limitMove(long&);
+  boolean fitsMove(long dist) { return dist<=CLEARPATH_MAX_MOVE(fractionalBits) && dist>=-CLEARPATH_MAX_MOVE(fractionalBits); }
+  uint16_t tickHz();
+  int32_t velLimitQx(long);
+  int16_t accLimitQx(long);
+  virtual int calcStepsFor(ClearPathAxisState& a) { return a.calcStepsQ<10>(); }	// calcSteps() on any axis state
+#if CLEARPATH_BATCHED_AXES
+  ClearPathAxisState* _axis;				// This motor's entry in the ClearPathStepGen
+#endif
 
-// All of the position, velocity and acceleration parameters are signed and in Q24.8,
-// with all arithmetic performed in fixed point.
+  ClearPathAxisState& axis()
+  {
+#if CLEARPATH_BATCHED_AXES
+	return *_axis;
+#else
+	return *this;
+#endif
+  }
 
- int32_t VelLimitQx;					// Velocity limit
- int32_t AccLimitQx;					// Acceleration limit
- uint32_t MovePosnQx;					// Current position
- uint32_t StepsSent;				// Accumulated integer position
- int32_t VelRefQx;					// Current velocity
- int32_t AccelRefQx;					// Current acceleration
- long _TX;					// Current time
- long _TX1;				// End of ramp up time
- long _TX2;				// Beginning of phase 2 time
- long _TX3;				// Beginning of ramp down time
- long _TAUX;					// Integer burst value
- boolean _flag;
- int32_t AccelRefQxS;
- long TargetPosnQx;						// Move length in Q24.8
- long TriangleMovePeakQx;	
- uint8_t fractionalBits;
+};
 
+/*
+	A ClearPathMotorSD which tracks its move in Q(32-FracBits).FracBits instead of Q22.10.
+	More fractional bits give finer velocity and acceleration resolution, at the cost of a shorter maximum move.
+*/
+template<uint8_t FracBits>
+class ClearPathMotorSDQ : public ClearPathMotorSD
+{
+  public:
+  static_assert(FracBits >= 8 && FracBits <= 16, "ClearPathMotorSDQ supports 8 to 16 fractional bits");
+  static_assert(!CLEARPATH_BATCHED_AXES || FracBits == 10, "CLEARPATH_BATCHED_AXES only supports Q22.10 motors");
+  ClearPathMotorSDQ() { fractionalBits=FracBits; }
+  int calcSteps() { return axis().template calcStepsQ<FracBits>(); }
+  protected:
+  int calcStepsFor(ClearPathAxisState& a) { return a.template calcStepsQ<FracBits>(); }
 };
 #endif
\ No newline at end of file
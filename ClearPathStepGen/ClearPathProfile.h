@@ -0,0 +1,203 @@
+/*
+  ClearPathProfile.h - Moves worked out at compile time into flash tables of steps per tick- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  ClearPathProfile<Dist, VelMax, AccelMax, TickHz, FracBits> is a move known when the sketch is compiled.
+  The compiler works out the steps calcSteps() sends on each tick of the move, for a motor given
+  setMaxVel(VelMax) and setMaxAccel(AccelMax) on a step generator ticking at TickHz (CLEARPATH_TICK_HZ by
+  default) in Q(32-FracBits).FracBits (Q22.10 by default), and stores them in flash, one byte per tick.
+  Nothing is planned while the sketch runs, and the table can be printed and checked before the move is made.
+
+   typedef ClearPathProfile<12000, 50000, 200000> ToolChange;
+   ...
+   X.playMove(ToolChange::table());
+
+  The functions and values of a ClearPathProfile are:
+
+   table() - returns a ClearPathBurstTable which plays the move, see ClearPathMotorSD::playMove()
+
+   TICKS - the number of ticks the move takes, and the length of the table
+
+   steps[] - the steps of each tick, in flash (read with pgm_read_byte())
+
+  The move is worked out in closed form for each phase of the move, so the compiler never steps through
+  it tick by tick and only standard C++11 constexpr is needed.
+ */
+#ifndef ClearPathProfile_h
+#define ClearPathProfile_h
+#include "Arduino.h"
+#include "ClearPathConfig.h"
+#include "ClearPathFixed.h"
+#include "ClearPathBurstTable.h"
+
+/*
+	The arithmetic of calcStepsQ<>() in closed form.  Every value is in the motor's fixed point format, k counts
+	the position updates of the move (one per tick after the first), and 64 bits keep the products exact.
+*/
+struct ClearPathProfileMath
+{
+	typedef int64_t q_t;
+
+	static constexpr q_t min(q_t a, q_t b) { return a<b ? a : b; }
+	static constexpr q_t max(q_t a, q_t b) { return a>b ? a : b; }
+	static constexpr q_t ceilDiv(q_t a, q_t b) { return (a+b-1)/b; }
+
+	// setMaxVel() and setMaxAccel()
+	static constexpr q_t scaleToTick(q_t value, uint8_t shift, q_t hz)
+	{
+		return ((value/hz)<<shift) + (((value%hz)<<shift)/hz);
+	}
+	static constexpr q_t velLimit(q_t velMax, q_t hz, uint8_t bits)
+	{
+		return velMax/hz<51 ? scaleToTick(velMax, bits, hz) : (q_t)50<<bits;
+	}
+	static constexpr q_t accLimit(q_t accelMax, q_t hz, uint8_t bits)
+	{
+		return min(scaleToTick(min(accelMax, 2000000), bits, hz)/hz, 32767);
+	}
+
+	// Position after k updates at acceleration a, velocity starting at a
+	static constexpr q_t ramp(q_t a, q_t k) { return a*k*(k+1)/2 + k*(a>>1); }
+
+	// Position after m updates slowing by a from velocity v, starting at p
+	static constexpr q_t slow(q_t p, q_t v, q_t a, q_t m) { return p + m*v - a*m*(m-1)/2 - m*((a+1)/2); }
+
+	// The first k in [lo,hi) with ramp(a,k) >= peak, or hi
+	static constexpr q_t firstRamp(q_t a, q_t peak, q_t lo, q_t hi)
+	{
+		return lo>=hi ? hi :
+			ramp(a, lo+(hi-lo)/2) >= peak ? firstRamp(a, peak, lo, lo+(hi-lo)/2)
+				: firstRamp(a, peak, lo+(hi-lo)/2+1, hi);
+	}
+
+	// The first m in [lo,hi) with slow(p,v,a,m) > target, or hi
+	static constexpr q_t firstSlow(q_t p, q_t v, q_t a, q_t target, q_t lo, q_t hi)
+	{
+		return lo>=hi ? hi :
+			slow(p, v, a, lo+(hi-lo)/2) > target ? firstSlow(p, v, a, target, lo, lo+(hi-lo)/2)
+				: firstSlow(p, v, a, target, lo+(hi-lo)/2+1, hi);
+	}
+};
+
+// A list of tick numbers, built in halves so a long move does not nest templates a tick deep
+template<uint16_t... I> struct ClearPathTicks {};
+
+template<class A, class B> struct ClearPathJoinTicks;
+template<uint16_t... I, uint16_t... J> struct ClearPathJoinTicks<ClearPathTicks<I...>, ClearPathTicks<J...> >
+{
+	typedef ClearPathTicks<I..., (uint16_t)(sizeof...(I)+J)...> type;
+};
+
+template<uint16_t N> struct ClearPathMakeTicks
+{
+	typedef typename ClearPathJoinTicks<typename ClearPathMakeTicks<N/2>::type,
+		typename ClearPathMakeTicks<N-N/2>::type>::type type;
+};
+template<> struct ClearPathMakeTicks<0> { typedef ClearPathTicks<> type; };
+template<> struct ClearPathMakeTicks<1> { typedef ClearPathTicks<0> type; };
+
+// The flash table of a profile, one entry per tick
+template<class Profile, class Ticks> struct ClearPathProfileSteps;
+template<class Profile, uint16_t... I> struct ClearPathProfileSteps<Profile, ClearPathTicks<I...> >
+{
+	static const uint8_t steps[sizeof...(I)];
+};
+template<class Profile, uint16_t... I>
+const uint8_t ClearPathProfileSteps<Profile, ClearPathTicks<I...> >::steps[sizeof...(I)] PROGMEM = { Profile::stepsAt(I+1)... };
+
+template<long Dist, long VelMax, long AccelMax, uint16_t TickHz=CLEARPATH_TICK_HZ, uint8_t FracBits=10>
+struct ClearPathProfile
+{
+	typedef ClearPathProfileMath M;
+	typedef M::q_t q_t;
+	static_assert(FracBits >= 8 && FracBits <= 16, "ClearPathProfile supports 8 to 16 fractional bits");
+
+	// The move as calcStepsQ<FracBits>() sees it
+	static constexpr q_t ONE = (q_t)1<<FracBits;
+	static constexpr q_t DIST = Dist<0 ? -(q_t)Dist : Dist;
+	static constexpr q_t TARGET = DIST*ONE;
+	static constexpr q_t PEAK = TARGET>>1;
+	static constexpr q_t VEL = M::velLimit(VelMax, TickHz, FracBits);
+	static constexpr q_t ACC = M::accLimit(AccelMax, TickHz, FracBits);
+	static_assert(VEL > 0 && ACC > 0, "ClearPathProfile needs a velocity and acceleration above zero");
+	static_assert(DIST != 0, "ClearPathProfile needs a move of at least one count");
+	static_assert(DIST <= CLEARPATH_MAX_MOVE(FracBits), "ClearPathProfile move is too long for the format");
+
+	// Moves no longer than two ticks of acceleration are sent on the first tick
+	static constexpr bool IMMEDIATE = PEAK <= ACC;
+	static_assert(!IMMEDIATE || DIST <= 255, "ClearPathProfile move is sent in one tick, and must be 255 counts or less");
+
+	// The velocity limit is reached on update KV, unless half the move is reached first
+	static constexpr q_t KV = M::max(1, M::ceilDiv(VEL, ACC)-1);
+	static constexpr bool CRUISE = M::ramp(ACC, KV) < PEAK;
+
+	// Half the move is reached on update KP, and the ramp down starts one update after
+	static constexpr q_t KP = CRUISE ? KV + M::ceilDiv(PEAK - M::ramp(ACC, KV), VEL) : M::firstRamp(ACC, PEAK, 1, KV);
+	static constexpr q_t KT = KP+1;
+
+	// The move's time parameters, as _TX1, _TX2, _TX3 and _TAUX
+	static constexpr q_t TX1 = CRUISE ? KV+1 : KT+1;
+	static constexpr q_t TX2 = KT+1;
+	static constexpr q_t TX3 = 2*TX2 - TX1;
+	static constexpr q_t TAUX = 2*TX2;
+
+	// The ramp down starts on tick TXD from position PS at velocity VS
+	static constexpr q_t TXD = CRUISE ? TX3+1 : KT+2;
+	static constexpr q_t VS = CRUISE ? VEL : ACC*(KT+1);
+	static constexpr q_t PS = CRUISE ? M::ramp(ACC, KV) + (TX3-1-KV)*VEL : M::ramp(ACC, KT);
+
+	// The ramp down ends once it is past the target, the velocity reverses, or it runs out of time
+	static constexpr q_t MU = M::min(VS/ACC + 1, TAUX - TXD + 2);
+	static constexpr q_t ME = M::firstSlow(PS, VS, ACC, TARGET, 1, MU);
+	static constexpr q_t END0 = IMMEDIATE ? 1 : (CRUISE && PS > TARGET) ? TX3 : TXD + ME - 1;
+
+	// Position at the end of tick t, counted from 1, before the move is ended
+	static constexpr q_t rawPosition(q_t t)
+	{
+		return t<=1 && !IMMEDIATE ? 0 :
+			t-1 <= (CRUISE ? KV : KT) ? M::ramp(ACC, t-1) :
+			CRUISE && t <= TX3 ? M::ramp(ACC, KV) + (t-1-KV)*VEL :
+			M::slow(PS, VS, ACC, t-TXD+1);
+	}
+
+	// The first tick in [lo,hi) which reaches the target, or hi.  The position only rises before END0
+	static constexpr q_t firstAtTarget(q_t lo, q_t hi)
+	{
+		return lo>=hi ? hi :
+			rawPosition(lo+(hi-lo)/2) >= TARGET ? firstAtTarget(lo, lo+(hi-lo)/2)
+				: firstAtTarget(lo+(hi-lo)/2+1, hi);
+	}
+
+	// Any tick which reaches the target ends the move early
+	static constexpr q_t END = IMMEDIATE ? 1 : firstAtTarget(2, END0);
+
+	static constexpr uint16_t TICKS = END;
+	static_assert(END <= 65535, "ClearPathProfile move is longer than 65535 ticks");
+
+	// Position at the end of tick t, counted from 1
+	static constexpr q_t position(q_t t)
+	{
+		return t>=END ? TARGET : rawPosition(t);
+	}
+
+	// Steps sent on tick t, counted from 1
+	static constexpr uint8_t stepsAt(q_t t)
+	{
+		return (uint8_t)M::max(0, (position(t)>>FracBits) - (t<=1 ? 0 : position(t-1)>>FracBits));
+	}
+
+	typedef ClearPathProfileSteps<ClearPathProfile, typename ClearPathMakeTicks<TICKS>::type> Steps;
+
+	static ClearPathBurstTable table() { return ClearPathBurstTable(Steps::steps, TICKS, Dist); }
+};
+
+#endif
@@ -16,12 +16,29 @@
   The motors are pulsed in the background according to move information stored within each motor.
   Only motors of type; ClearPathMotorSD may be used.
 
-  There can only be one instance of Step Controller at any time.
+  Several step generators can run at once, each on its own hardware timer with its own motors and tick rate.
+  Each timer in CLEARPATH_TIMERS (see ClearPathConfig.h) gets an ISR which runs the step generator started on it.
 
-  This class uses Timer2, so other functions and classes which use timer 2 will not work correctly ie: tone(), MsTimer2() etc.
+  This class uses Timer2 by default, so other functions and classes which use timer 2 will not work correctly ie: tone(), MsTimer2() etc.
+  CLEARPATH_TIMER in ClearPathConfig.h moves it to Timer1, or Timer3, 4 or 5 on a Mega.
 
   The ISR is set to 2KHz, nominally
 
+  Only axes with a command are worked on each tick, and when no axis has one the tick is turned off
+  altogether until a motor is given a move.
+
+  With CLEARPATH_INTERRUPTIBLE_ISR set in ClearPathConfig.h the ISR runs with other interrupts enabled, and only
+  turns them off for each write to PORTB, see ClearPathConfig.h
+
+  With CLEARPATH_SPREAD_STEPS set in ClearPathConfig.h each tick's steps are spread across the tick, using
+  the timer's second (B) compare to time the slots, see ClearPathConfig.h
+
+  With CLEARPATH_PLAN_TICKS set in ClearPathConfig.h the moves are worked out ahead of time by plan(), called
+  from loop(), and the ISR only sends the steps planned for each tick, see ClearPathConfig.h
+
+  With CLEARPATH_BATCHED_AXES set in ClearPathConfig.h the step controller also keeps the move state of its motors
+  in one contiguous array and updates all of them with a single call per tick, see ClearPathConfig.h
+
   Note: Each attached motor must have its direction/B pin connected to one of pins 8-13
 
   other devices can be connected to pins 8-13 as well
@@ -30,96 +47,456 @@
    Start(time)     - gets Direction pins for all connected motors (make sure all motors have been attached before this is called
 						Configures the ISR to run at 2kHz
    Stop() - disables the ISR in this class
-   
- */
-#include "Arduino.h"
-#include "ClearPathMotorSD.h"
-#include "ClearPathStepGen.h"
 
+   setTimer() - picks the hardware timer and tick rate, call before Start()
 
-// Declare Variables used in this class
-// They aren't private because the ISR needs to access them
-ClearPathMotorSD* _motors[6];					//6 clearpath motor pointers for up to 6 digital pins in PORTB
-uint8_t _numAxis=0;							//this keeps track of how many pointers are active
-uint8_t _BurstSteps[6]={0, 0, 0, 0, 0, 0};	//this is the container for the motors to dump however many steps need to be pulsed
-uint8_t _pins[6]={0, 0, 0, 0, 0, 0};		//This holds the port address (Binary) for each motors Step Pin
-uint8_t _SUMPINS=0;							//This holds the Binary Sum of all active motor Step Pin addresses
-uint8_t _OutputBits;						//this is the container to write to output PORTB
-boolean _flag=false;						//This is the flag to show when to finish pulsing the motors
+   getSnapshot() - copies the position, velocity and move state of every axis, all from the same tick (CLEARPATH_SNAPSHOTS)
 
+   getISRStats() - copies the ISR timing kept when CLEARPATH_ISR_STATS is set in ClearPathConfig.h
 
+   resetISRStats() - clears the ISR timing
 
+   getOverruns() - returns how many times the ISR ran past the end of its tick
 
-//This is the Interupt Service Routine.
-// It asks each motor how many steps to send, and then pulses to PORTB
-ISR(TIMER2_COMPA_vect)
-{  
-	//Prevent Interupts
-	cli();
+   setDegradedBurst() - sets the per tick step limit applied to every axis after an overrun, 0 (default) to never degrade
 
-//Turn on pin 2 to see how long the ISR takes
-//  digitalWrite(2,HIGH);
+   isDegraded() - returns true while that limit is applied
 
-//Poll all axes to fill BurstSteps[]
-  for(int i=0;i<_numAxis;i++)
-  {
-	  _BurstSteps[i]=_motors[i]->calcSteps();
-  }
-	  
+   plan() - plans the moves ahead into the tick buffer when CLEARPATH_PLAN_TICKS is set, call it often from loop()
 
-	  
-	//loop through BurstSteps decrementing each value to 0	  
+   getUnderruns() - returns how many ticks found the tick buffer empty while a move was still being planned
+
+   moveSync() - moves several motors at once so they all start and finish on the same tick
+
+   moveAll() - starts a move() on several motors at once, all on the same tick
+   
+ */
+#include "Arduino.h"
+#include "ClearPathMotorSD.h"
+#include "ClearPathStepGen.h"
+#include "ClearPathTimer.h"
+
+ClearPathStepGen* ClearPathStepGen::_onTimer[6];
+
+//This returns the timer functions for a timer number, or 0 if the library does not take that timer's interrupts
+static const ClearPathTimerOps* timerOps(uint8_t timer)
+{
+	switch(timer)
+	{
+#if CLEARPATH_TIMERS & (1<<1)
+	case 1: return clearPathTimerOps<1>();
+#endif
+#if CLEARPATH_TIMERS & (1<<2)
+	case 2: return clearPathTimerOps<2>();
+#endif
+#if CLEARPATH_TIMERS & (1<<3)
+	case 3: return clearPathTimerOps<3>();
+#endif
+#if CLEARPATH_TIMERS & (1<<4)
+	case 4: return clearPathTimerOps<4>();
+#endif
+#if CLEARPATH_TIMERS & (1<<5)
+	case 5: return clearPathTimerOps<5>();
+#endif
+	}
+	return 0;
+}
+
+//This pulses PORTB, sending each axis the number of steps in steps[], and leaves steps[] at 0
+void ClearPathStepGen::sendPulses(uint16_t* steps)
+{
+	//loop through steps decrementing each value to 0	  
 	do
 	{
 
 		_flag=false;
 
+#if CLEARPATH_INTERRUPTIBLE_ISR
+		_OutputBits = 0;		//Collect the step bits, they are OR'd into the port below
+#else
 		_OutputBits = PORTB;	//Read the port
+#endif
 
-		if(_BurstSteps[0] && _BurstSteps[0]--)	//Assume at least one axis is active, and check/decrement BurstSteps
+		if(steps[0] && steps[0]--)	//Assume at least one axis is active, and check/decrement BurstSteps
 		{
 			_flag=true;
 			_OutputBits |= _pins[0];	//Activate the B input for motor 1
 		}
-		if(_pins[1] > 0 && _BurstSteps[1] && _BurstSteps[1]--)	//Check if Axis is active, then check/decrement BurstSteps
+		if(_pins[1] > 0 && steps[1] && steps[1]--)	//Check if Axis is active, then check/decrement BurstSteps
 		{
 			_flag=true;
 			_OutputBits |= _pins[1];	//Activate the B input for motor 2
 		}
-		if(_pins[2] > 0 && _BurstSteps[2] && _BurstSteps[2]--)	//Check if Axis is active, then check/decrement BurstSteps
+		if(_pins[2] > 0 && steps[2] && steps[2]--)	//Check if Axis is active, then check/decrement BurstSteps
 		{
 			_flag=true;
 			_OutputBits |= _pins[2];	//Activate the B input for motor 3
 		}
-		if(_pins[3] > 0 && _BurstSteps[3] && _BurstSteps[3]--)	//Check if Axis is active, then check/decrement BurstSteps
+		if(_pins[3] > 0 && steps[3] && steps[3]--)	//Check if Axis is active, then check/decrement BurstSteps
 		{
 			_flag=true;
 			_OutputBits |= _pins[3];	//Activate the B input for motor 4
 		}
-		if(_pins[4] > 0 && _BurstSteps[4] && _BurstSteps[4]--)	//Check if Axis is active, then check/decrement BurstSteps
+		if(_pins[4] > 0 && steps[4] && steps[4]--)	//Check if Axis is active, then check/decrement BurstSteps
 		{
 			_flag=true;
 			_OutputBits |= _pins[4];	//Activate the B input for motor 5
 		}
-		if(_pins[5] > 0 && _BurstSteps[5] && _BurstSteps[5]--)	//Check if Axis is active, then check/decrement BurstSteps
+		if(_pins[5] > 0 && steps[5] && steps[5]--)	//Check if Axis is active, then check/decrement BurstSteps
 		{
 			_flag=true; 
 			_OutputBits |= _pins[5];	//Activate the B input for motor 6
 		}
+#if CLEARPATH_INTERRUPTIBLE_ISR
+		//Other interrupts may write PORTB too, so only the read-modify-writes run with interrupts off
+		cli();
+		PORTB |= _OutputBits;			//Raise the step pins
+		sei();
+		delayMicroseconds(2);			//Short Delay, an interrupt here only lengthens the pulse
+		cli();
+		PORTB &= ~_SUMPINS;				//Turn off all active pins
+		sei();
+#else
 		PORTB = _OutputBits;			//Write to the ports
 		delayMicroseconds(2);			//Short Delay
 		_OutputBits &=63-_SUMPINS ;	//Turn off all active pins
 		PORTB = _OutputBits;			//Write to the ports
+#endif
 
 	} while(_flag);
+}
+
+//This is true while the tick has work to do: an axis with a command, or ticks of steps still in the plan
+inline boolean ClearPathStepGen::tickNeeded()
+{
+#if CLEARPATH_PLAN_TICKS
+	return _activeAxes!=0 || _planHead!=_planTail;
+#else
+	return _activeAxes!=0;
+#endif
+}
+
+#if CLEARPATH_SPREAD_STEPS
+//This works out how many steps each axis sends in the next slot, takes them out of _BurstSteps, and sends them
+void ClearPathStepGen::sendSlot()
+{
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		uint16_t n=_SlotQuot[i];
+		_SlotAcc[i]+=_SlotRem[i];
+		if(_SlotAcc[i]>=_slots)
+		{
+			_SlotAcc[i]-=_slots;
+			n++;
+		}
+		_SlotSteps[i]=n;
+		_BurstSteps[i]-=n;
+	}
+	sendPulses(_SlotSteps);
+}
+
+//This sends every slot whose time has come and sets the timer's B compare to the next one.
+// It returns true if there is another slot, the caller then enables the B compare interrupt
+template<uint8_t N> boolean ClearPathStepGen::runSlots()
+{
+	typedef ClearPathTimer<N> TickTimer;
+	for(;;)
+	{
+		sendSlot();
+		if(++_slot>=_slots)
+			return false;
+		typename TickTimer::count_t next=_slot*_slotLen;
+		TickTimer::setSlot(next);		//Also clears any match from before the compare moved
+		if(TickTimer::count()<next)
+			return true;
+		//Otherwise the slot's time has already passed, so send it now
+	}
+}
+
+//This splits this tick's bursts into evenly spaced slots, one slot per step of the busiest axis up to
+// CLEARPATH_SPREAD_STEPS, and sends the first.  Each axis' steps are spread over the slots like a line
+// is drawn over pixels, the whole number per slot every slot and the remainder in evenly spaced slots.
+template<uint8_t N> boolean ClearPathStepGen::startSlots()
+{
+	uint16_t most=0;
+	for(uint8_t i=0;i<_numAxis;i++)
+		if(_BurstSteps[i]>most)
+			most=_BurstSteps[i];
+	if(most<2)
+	{
+		_slot=_slots=0;
+		sendPulses(_BurstSteps);
+		return false;
+	}
+	_slots=most<CLEARPATH_SPREAD_STEPS ? most : CLEARPATH_SPREAD_STEPS;
+	_slotLen=((uint32_t)ClearPathTimer<N>::top()+1)/_slots;		//A 16 bit timer's top()+1 is 65536
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		_SlotQuot[i]=_BurstSteps[i]/_slots;
+		_SlotRem[i]=_BurstSteps[i]%_slots;
+		_SlotAcc[i]=_slots>>1;		//Start half way so the remainder lands in the middle of the tick
+	}
+	_slot=0;
+	return runSlots<N>();
+}
+
+//This is the Interupt Service Routine for the slots after the first in each tick
+template<uint8_t N> void ClearPathStepGen::slot()
+{
+	typedef ClearPathTimer<N> TickTimer;
+#if CLEARPATH_INTERRUPTIBLE_ISR
+	TickTimer::disableTick();
+	TickTimer::disableSlot();
+	sei();
+#endif
+	boolean more=runSlots<N>();
+#if CLEARPATH_INTERRUPTIBLE_ISR
+	cli();
+	if(tickNeeded())
+		TickTimer::enableTick();		//Left off while idle, as the tick's own ISR does
+#endif
+	if(!more)
+		TickTimer::disableSlot();
+	else
+		TickTimer::enableSlot();
+}
+#endif
+
+#if CLEARPATH_SYNC_MOVES
+//This advances the lead of a moveSync() by a tick, before the motors following it work out their steps.
+// While degraded it waits for any of them holding back a full burst, so they stay together
+void ClearPathStepGen::syncTick()
+{
+	if(_degraded)
+		for(uint8_t i=0;i<_numAxis;i++)
+		{
+			ClearPathAxisState& a=axisState(i);
+			if(a.moveStateX==7 && a.saturated())
+				return;
+		}
+	_motors[_syncLead]->calcStepsFor(_sync);
+}
+#endif
+
+//This asks each active axis how many steps to send this tick, dropping each from _activeAxes once its command is sent
+void ClearPathStepGen::calcBursts(uint16_t* bursts)
+{
+#if CLEARPATH_SYNC_MOVES
+  if(_sync.busy())
+	  syncTick();
+#endif
+#if CLEARPATH_BATCHED_AXES
+  _activeAxes=ClearPathAxisState::calcAll(_axes, bursts, _numAxis, _activeAxes);
+#else
+  uint8_t active=_activeAxes;
+  for(int i=0;i<_numAxis;i++)
+  {
+	  uint8_t bit=1<<i;
+	  if(active & bit)
+	  {
+		  bursts[i]=_motors[i]->calcSteps();
+		  if(!_motors[i]->busy())
+			  active&=~bit;
+	  }
+	  else
+		  bursts[i]=0;
+  }
+  _activeAxes=active;
+#endif
+}
+
+//This publishes the state of every axis into the snapshot buffer readers are not using, then flips to it
+void ClearPathStepGen::publishSnapshot()
+{
+#if CLEARPATH_SNAPSHOTS
+	ClearPathSnapshot& snap=_snapshots[(_snapshotSeq+1)&1];
+	snap.tick=++_tickCount;
+	snap.numAxis=_numAxis;
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		ClearPathAxisState& a=axisState(i);
+		snap.position[i]=a.AbsPosition;
+		snap.velocity[i]=a.velocityQx();
+		snap.state[i]=a.moveStateX;
+	}
+	_snapshotSeq++;
+#endif
+}
+
+//This is the Interupt Service Routine.
+// It asks each motor how many steps to send, and then pulses to PORTB
+template<uint8_t N> void ClearPathStepGen::tick()
+{  
+	typedef ClearPathTimer<N> TickTimer;
+#if CLEARPATH_ISR_STATS
+	typename TickTimer::count_t entryTime=TickTimer::count();	//Time into the tick, read first so it is as close to entry as possible
+#endif
+#if CLEARPATH_INTERRUPTIBLE_ISR
+	//Keep this ISR (and the step slots) from interrupting itself, but let every other interrupt in
+	TickTimer::disableTick();
+	TickTimer::disableSlot();
+	sei();
+#else
+	//Prevent Interupts
+	cli();
+#endif
+#if CLEARPATH_SPREAD_STEPS
+	//Stop the last tick's slots, and send whatever they did not get to
+	TickTimer::disableSlot();
+	if(_slot<_slots)
+		sendPulses(_BurstSteps);
+#endif
+
+//Turn on pin 2 to see how long the ISR takes
+//  digitalWrite(2,HIGH);
+
+#if CLEARPATH_PLAN_TICKS
+	//Take this tick's steps from the plan, with nothing planned the motors wait a tick
+	uint8_t head=_planHead;
+	if(head!=_planTail)
+	{
+		for(uint8_t i=0;i<_numAxis;i++)
+		{
+			_BurstSteps[i]=_plan[head][i];
+			if(_BurstSteps[i])
+				_planQueued[i]--;
+		}
+		_planHead=(head+1<CLEARPATH_PLAN_TICKS) ? head+1 : 0;
+	}
+	else if(_activeAxes)
+		_underruns++;
+#else
+	calcBursts(_BurstSteps);
+#endif
+	  
+#if CLEARPATH_SPREAD_STEPS
+	boolean slotsArmed=startSlots<N>();
+#else
+	sendPulses(_BurstSteps);
+#endif
+
+#if CLEARPATH_SNAPSHOTS && !CLEARPATH_PLAN_TICKS
+	publishSnapshot();
+#endif
+
+#if CLEARPATH_ISR_STATS
+	uint16_t exitTime=TickTimer::count();
+#endif
+	//Check for an overrun, the compare flag is set again if the ISR ran past the end of its tick
+	boolean overran=TickTimer::tickPending();
+	if(overran)
+	{
+		_overruns++;
+#if !CLEARPATH_PLAN_TICKS
+		if(_degradedBurst!=0 && !_degraded)
+		{
+			//Cap every axis' burst so the following ticks fit, the ramps stretch to match
+			_degraded=true;
+			for(uint8_t i=0;i<_numAxis;i++)
+				axisState(i).capBurst(_degradedBurst);
+		}
+	}
+	else if(_degraded)
+	{
+		//Lift the caps once every axis has finished its move
+		uint8_t i=0;
+		while(i<_numAxis && axisState(i).moveStateX==3)
+			i++;
+		if(i==_numAxis)
+		{
+			_degraded=false;
+			for(i=0;i<_numAxis;i++)
+				axisState(i).capBurst(0);
+		}
+#endif
+	}
+
+#if CLEARPATH_ISR_STATS
+	//Time the ISR, after an overrun the timer has wrapped so read it again and add a period
+	uint8_t bucket;
+	if(overran)
+	{
+		exitTime=TickTimer::count()+TickTimer::top()+1;
+		bucket=CLEARPATH_ISR_STATS_BUCKETS-1;
+	}
+	else
+		bucket=exitTime>>_statShift;		//64us buckets at 2kHz
+	uint16_t isrTime=exitTime-entryTime;
+	if(isrTime<_statMin)
+		_statMin=isrTime;
+	if(isrTime>_statMax)
+		_statMax=isrTime;
+	if(entryTime>_statMaxLatency)
+		_statMaxLatency=entryTime;
+	_statSum+=isrTime;
+	_statCount++;
+	if(_statSum & 0x80000000UL)		//Halve both before the sum overflows, the mean stays the same
+	{
+		_statSum>>=1;
+		_statCount>>=1;
+	}
+	_statSamples++;
+	_statHistogram[bucket]++;
+#endif
 
 	//turn off debug pin
 	//digitalWrite(2,LOW);
+#if CLEARPATH_INTERRUPTIBLE_ISR
+	//Let the next tick in again, with interrupts off so it waits for this ISR to return.
+	// With no active axes it stays off until a motor is given a command
+	cli();
+	if(tickNeeded())
+		TickTimer::enableTick();
+#else
+	//With no active axes turn the tick off until a motor is given a command
+	if(!tickNeeded())
+		TickTimer::disableTick();
+#endif
+#if CLEARPATH_SPREAD_STEPS
+	if(slotsArmed)
+		TickTimer::enableSlot();
+#endif
+#if !CLEARPATH_INTERRUPTIBLE_ISR
 	//allow interupts
 	sei();
+#endif
 
 }
 
+//The ISRs of each timer run the step generator started on that timer
+struct ClearPathStepGenISR
+{
+	template<uint8_t N> static inline void tick() { ClearPathStepGen::_onTimer[N]->tick<N>(); }
+#if CLEARPATH_SPREAD_STEPS
+	template<uint8_t N> static inline void slot() { ClearPathStepGen::_onTimer[N]->slot<N>(); }
+#endif
+};
+
+#if CLEARPATH_SPREAD_STEPS
+#define CLEARPATH_TIMER_ISRS(n) \
+ISR(TIMER##n##_COMPA_vect) { ClearPathStepGenISR::tick<n>(); } \
+ISR(TIMER##n##_COMPB_vect) { ClearPathStepGenISR::slot<n>(); }
+#else
+#define CLEARPATH_TIMER_ISRS(n) \
+ISR(TIMER##n##_COMPA_vect) { ClearPathStepGenISR::tick<n>(); }
+#endif
+
+#if CLEARPATH_TIMERS & (1<<1)
+CLEARPATH_TIMER_ISRS(1)
+#endif
+#if CLEARPATH_TIMERS & (1<<2)
+CLEARPATH_TIMER_ISRS(2)
+#endif
+#if CLEARPATH_TIMERS & (1<<3)
+CLEARPATH_TIMER_ISRS(3)
+#endif
+#if CLEARPATH_TIMERS & (1<<4)
+CLEARPATH_TIMER_ISRS(4)
+#endif
+#if CLEARPATH_TIMERS & (1<<5)
+CLEARPATH_TIMER_ISRS(5)
+#endif
+
 /* This is the minimum constructor for ClearPathStepGen it requires a pointer to one ClearPathMotorSD, or
 	one ClearPathMotorSD motor.  It requires a pointer because this class must use the functions of the
 	same clearpath object used in the main routine.
@@ -136,6 +513,7 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1)
 	if(_motors[0]->PinB-8 >= 0)
 		_pins[0]=(1<<(_motors[0]->PinB-8));
 	_SUMPINS=_pins[0];
+	bindAxes();
 }
 
 /* This is a constructor for ClearPathStepGen, it requires 2 pointer to ClearPathMotorSD, or
@@ -157,6 +535,7 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* m
 	if(_motors[1]->PinB-8 >= 0)
 		_pins[1]=(1<<(_motors[1]->PinB-8));
 	_SUMPINS=_pins[0]+_pins[1];
+	bindAxes();
 }
 
 /* This is a constructor for ClearPathStepGen, it requires 3 pointer to ClearPathMotorSD, or
@@ -181,7 +560,7 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* m
    if(_motors[2]->PinB-8 >= 0)
     _pins[2]=(1<<(_motors[2]->PinB-8));
    _SUMPINS=_pins[0]+_pins[1]+_pins[2];
-  
+   bindAxes();
 }
 
 /* This is a constructor for ClearPathStepGen, it requires 4 pointer to ClearPathMotorSD, or
@@ -209,7 +588,7 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* m
    if(_motors[3]->PinB-8 >= 0)
    _pins[3]=(1<<(_motors[3]->PinB-8));
    _SUMPINS=_pins[0]+_pins[1]+_pins[2]+_pins[3];
-  
+   bindAxes();
 }
 
 /* This is a constructor for ClearPathStepGen, it requires 5 pointer to ClearPathMotorSD, or
@@ -240,7 +619,7 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* m
    if(_motors[4]->PinB-8 >= 0)
     _pins[4]=(1<<(_motors[4]->PinB-8));
    _SUMPINS=_pins[0]+_pins[1]+_pins[2]+_pins[3]+_pins[4];
-  
+   bindAxes();
 }
 
 /* This is a constructor for ClearPathStepGen, it requires 6 pointer to ClearPathMotorSD, or
@@ -274,16 +653,488 @@ ClearPathStepGen::ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* m
    if(_motors[5]->PinB-8 >= 0)
     _pins[5]=(1<<(_motors[5]->PinB-8));
    _SUMPINS=_pins[0]+_pins[1]+_pins[2]+_pins[3]+_pins[4]+_pins[5];
-  
+   bindAxes();
+}
+
+/*
+	This function ties each motor to this step generator, and when CLEARPATH_BATCHED_AXES is set hands it its entry in
+	the shared axis state array and puts that entry in the move idle state.  It also picks the default timer.
+*/
+void ClearPathStepGen::bindAxes()
+{
+	_ops=timerOps(_timer);
+#if CLEARPATH_SYNC_MOVES
+	_sync.reset();
+#endif
+	for(int i=0; i<_numAxis; i++)
+	{
+#if CLEARPATH_BATCHED_AXES
+		_axes[i].reset();
+		_motors[i]->_axis=&_axes[i];
+#endif
+		_motors[i]->_axisBit=1<<i;
+		_motors[i]->_stepGen=this;
+	}
+}
+
+/*
+	This function picks the hardware timer (1-5) and the tick rate in Hz this step generator runs on.  It must be
+	called before Start(), and returns false if the timer is not in CLEARPATH_TIMERS, is used by another running
+	step generator, or cannot make that rate (Timer2 cannot go below 1954Hz at 16MHz).
+	The velocity and acceleration limits of the motors are converted again for the new rate.  A slower rate needs more
+	bits for the same acceleration, so call setMaxAccel() again afterwards to check each one still fits.
+*/
+boolean ClearPathStepGen::setTimer(uint8_t timer, uint16_t tickHz)
+{
+	const ClearPathTimerOps* ops=timerOps(timer);
+	if(_running || ops==0 || tickHz==0)
+		return false;
+	unsigned long counts=F_CPU/ops->prescale/tickHz;
+	if(counts<2 || counts>ops->maxCounts)
+		return false;
+	if(_onTimer[timer]!=0 && _onTimer[timer]!=this && _onTimer[timer]->_running)
+		return false;
+	_timer=timer;
+	_tickHz=tickHz;
+	_ops=ops;
+	for(int i=0; i<_numAxis; i++)
+	{
+		_motors[i]->setMaxVel(_motors[i]->_velMax);
+		_motors[i]->setMaxAccel(_motors[i]->_accelMax);
+	}
+	return true;
+}
+
+/*
+	This function is called by a motor when it accepts a command.  It marks the axis active so the ISR
+	works on it again, and turns the tick back on if every axis was idle.
+*/
+void ClearPathStepGen::activate(uint8_t axisBit)
+{
+	cli();
+	activateNow(axisBit);
+	sei();
+}
+
+/*
+	This function marks several axes active at once, as activate() does, for callers which already have interrupts off
+	so the axes' new commands and their activation reach the ISR together.
+*/
+void ClearPathStepGen::activateNow(uint8_t axisBits)
+{
+	_activeAxes|=axisBits;
+#if !CLEARPATH_PLAN_TICKS
+	if(_running)
+		_ops->enableTick();		//When planning ahead plan() turns it on, once there is something to send
+#endif
+}
+
+/*
+	This function returns true while steps planned for an axis are waiting to be sent, or with CLEARPATH_SPREAD_STEPS
+	while the slots of the last tick still have steps to send for it.
+	A motor's command is done, and it takes a new one, only once they have all gone out, so the direction pin is
+	never changed under steps still to be sent.
+*/
+boolean ClearPathStepGen::queued(uint8_t axisBit)
+{
+#if CLEARPATH_PLAN_TICKS || CLEARPATH_SPREAD_STEPS
+	uint8_t i=0;
+	while((1<<i)!=axisBit)
+		i++;
+	boolean waiting=false;
+#if CLEARPATH_PLAN_TICKS
+	waiting=_planQueued[i]!=0;
+#endif
+#if CLEARPATH_SPREAD_STEPS
+	cli();
+	if(_slot<_slots && _BurstSteps[i]!=0)		//The slots take their steps out of _BurstSteps as they send them
+		waiting=true;
+	sei();
+#endif
+	return waiting;
+#else
+	(void)axisBit;		//Nothing is planned ahead
+	return false;
+#endif
+}
+
+/*
+	This function plans the moves ahead when CLEARPATH_PLAN_TICKS is set in ClearPathConfig.h, and should be called
+	from loop() at least once every few ticks.  It works out the steps of each tick exactly as the ISR otherwise
+	would, and fills the tick buffer until it is full or every move is planned.  It returns the number of ticks planned.
+	If the buffer runs dry during a move the motors pause for those ticks and getUnderruns() counts them.
+	The positions, velocities and snapshots of the motors run ahead of the steps sent by up to a buffer of ticks,
+	and a stopMove() still sends the steps already planned.
+	Without CLEARPATH_PLAN_TICKS it does nothing.
+*/
+uint8_t ClearPathStepGen::plan()
+{
+	uint8_t planned=0;
+#if CLEARPATH_PLAN_TICKS
+	for(;;)
+	{
+		uint8_t tail=_planTail;
+		uint8_t next=(tail+1<CLEARPATH_PLAN_TICKS) ? tail+1 : 0;
+		if(next==_planHead || !_activeAxes)
+			break;
+		uint16_t* bursts=_plan[tail];
+		calcBursts(bursts);
+#if CLEARPATH_SNAPSHOTS
+		publishSnapshot();
+#endif
+		//Hand the tick to the ISR
+		cli();
+		for(uint8_t i=0;i<_numAxis;i++)
+			if(bursts[i])
+				_planQueued[i]++;
+		_planTail=next;
+		sei();
+		planned++;
+	}
+	if(planned && _running)
+	{
+		cli();
+		_ops->enableTick();
+		sei();
+	}
+#endif
+	return planned;
+}
+
+/*
+	This function returns how many ticks found nothing planned while a move was still being planned,
+	ie: plan() was not called often enough.  Each one delays the moves by a tick.
+*/
+unsigned long ClearPathStepGen::getUnderruns()
+{
+#if CLEARPATH_PLAN_TICKS
+	cli();
+	unsigned long count=_underruns;
+	sei();
+	return count;
+#else
+	return 0;
+#endif
+}
+
+/*
+	This function makes a synchronized point to point move: every motor given a distance starts on the same tick
+	and finishes on the same tick, instead of the shorter moves finishing first.  Distances are in counts, in the
+	order the motors were passed to the ClearPathStepGen, and a motor given 0 is left alone.
+	The longest move is ramped like move() does, and every other motor moves its share of it on each tick, so its
+	velocity and acceleration are scaled down by its distance over the longest.  The limits of the longest move are
+	the highest which keep every motor within its own setMaxVel() and setMaxAccel().
+	Each motor's position follows the longest move's to within its distance over 65,536 counts, and is exact
+	once the move ends.  Each distance is checked against its motor's soft limits first (see setSoftLimits()).
+
+	Only one synchronized move runs at a time, as every follower takes its position from the one lead.
+	The lead costs RAM in every ClearPathStepGen, see CLEARPATH_SYNC_MOVES in ClearPathConfig.h.
+
+	The function will return true if the move was accepted.  It returns false, and moves nothing, if a motor given a
+	distance has a command, is disabled, would pass a soft limit, or its velocity or acceleration is not set, or if
+	an earlier moveSync() is still running.  It always returns false without CLEARPATH_SYNC_MOVES
+*/
+boolean ClearPathStepGen::moveSync(long dist1, long dist2, long dist3, long dist4, long dist5, long dist6)
+{
+#if CLEARPATH_SYNC_MOVES
+	if(syncBusy())
+		return false;
+	long dist[6]={dist1, dist2, dist3, dist4, dist5, dist6};
+	uint8_t axes=acceptAll(dist);
+	if(axes==0xFF)
+		return false;
+	if(axes==0)
+		return true;
+	unsigned long counts[6];
+	unsigned long longest=0;
+	uint8_t lead=0;
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		counts[i]= dist[i]<0 ? -dist[i] : dist[i];
+		ClearPathMotorSD* m=_motors[i];
+		if(counts[i]!=0 && (!axisState(i).Enabled || m->_velMax<=0 || m->_accelMax<=0))
+			return false;
+		if(counts[i]>longest)
+		{
+			longest=counts[i];
+			lead=i;
+		}
+	}
+
+	//The fastest the longest move can go with every motor's share of it within that motor's limits
+	float velMax=_motors[lead]->_velMax;
+	float accelMax=_motors[lead]->_accelMax;
+	uint32_t ratio[6];
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		if(!(axes & (1<<i)))
+			continue;
+		float scale=(float)longest/counts[i];
+		if(_motors[i]->_velMax*scale<velMax)
+			velMax=_motors[i]->_velMax*scale;
+		if(_motors[i]->_accelMax*scale<accelMax)
+			accelMax=_motors[i]->_accelMax*scale;
+		ratio[i]= i==lead ? 65536UL : ((uint64_t)counts[i]<<16)/longest;
+	}
+	ClearPathMotorSD* m=_motors[lead];
+	int32_t velQx=m->velLimitQx(velMax);
+	int16_t accQx=m->accLimitQx(accelMax);
+	if(velQx<=0 || accQx<=0)
+		return false;
+
+	setDirections(dist, axes);
+
+	cli();
+	_syncLead=lead;
+	_sync.Enabled=true;
+	_sync.VelLimitQx=velQx;
+	_sync.AccLimitQx=accQx;
+	_sync.MovePosnQx=0;
+	_sync.StepsSent=0;
+	_sync.CommandX=longest;
+	_sync.moveStateX=3;
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		if(!(axes & (1<<i)))
+			continue;
+		ClearPathAxisState& a=axisState(i);
+		uint8_t bits=_motors[i]->fractionalBits;
+		a._lead=&_sync;
+		a.SyncRatio=ratio[i];
+		a.SyncShift=bits-m->fractionalBits;
+		a.TargetPosnQx=(int32_t)counts[i]<<bits;
+		a.MovePosnQx=0;
+		a.StepsSent=0;
+		a.VelRefQx=0;
+		a._BurstX=0;
+		a.CommandX=counts[i];
+		a.moveStateX=7;
+	}
+	activateNow(axes);
+	sei();
+	return true;
+#else
+	(void)dist1; (void)dist2; (void)dist3; (void)dist4; (void)dist5; (void)dist6;
+	return false;
+#endif
+}
+
+#if CLEARPATH_SYNC_MOVES
+/*
+	This function returns true while any motor is still following the lead of a moveSync().
+	The lead itself is not checked: once every follower is done, or stopped by stopMove(), nothing reads it.
+*/
+boolean ClearPathStepGen::syncBusy()
+{
+	boolean busy=false;
+	cli();
+	for(uint8_t i=0;i<_numAxis;i++)
+		if(axisState(i).moveStateX==7)
+			busy=true;
+	sei();
+	return busy;
+}
+#endif
+
+/*
+	This function starts a move() on several motors at once, each ramping with its own velocity and acceleration.
+	Distances are in counts, in the order the motors were passed to the ClearPathStepGen, and a motor given 0 is
+	left alone.  The commands are all handed to the ISR with interrupts off, so every move starts on the same tick,
+	and the direction pins are all set before a single 1ms wait instead of one per move.  Each distance is checked
+	against its motor's soft limits, as move() does.
+
+	The function will return true if the moves were accepted.  It returns false, and moves nothing, if a motor given a
+	distance has a command or would pass a soft limit
+*/
+boolean ClearPathStepGen::moveAll(long dist1, long dist2, long dist3, long dist4, long dist5, long dist6)
+{
+	long dist[6]={dist1, dist2, dist3, dist4, dist5, dist6};
+	uint8_t axes=acceptAll(dist);
+	if(axes==0xFF)
+		return false;
+	if(axes==0)
+		return true;
+	setDirections(dist, axes);
+	cli();
+	for(uint8_t i=0;i<_numAxis;i++)
+		if(axes & (1<<i))
+			axisState(i).CommandX= dist[i]<0 ? -dist[i] : dist[i];
+	activateNow(axes);
+	sei();
+	return true;
+}
+
+/*
+	This function returns a bit for each motor given a distance by moveSync() or moveAll(), or 0xFF if one of them
+	has a command, is longer than its motor's move() accepts, would pass a soft limit which rejects, or there is no
+	motor for a distance.
+	Distances past a soft limit which clips are shortened to end on it.
+*/
+uint8_t ClearPathStepGen::acceptAll(long* dist)
+{
+	uint8_t axes=0;
+	for(uint8_t i=0;i<6;i++)
+	{
+		if(dist[i]==0)
+			continue;
+		if(i>=_numAxis || !_motors[i]->commandDone() || !_motors[i]->fitsMove(dist[i]) || !_motors[i]->limitMove(dist[i]))
+			return 0xFF;
+		if(dist[i]!=0)
+			axes|=1<<i;
+	}
+	return axes;
+}
+
+/*
+	This function sets the direction pin of every motor in axes for its distance, as move() does, then waits once
+	for all of them
+*/
+void ClearPathStepGen::setDirections(const long* dist, uint8_t axes)
+{
+	boolean dirs=false;
+	for(uint8_t i=0;i<_numAxis;i++)
+	{
+		if(!(axes & (1<<i)))
+			continue;
+		axisState(i)._direction= dist[i]<0;
+		if(_motors[i]->PinA!=0)
+		{
+			digitalWrite(_motors[i]->PinA, dist[i]<0 ? HIGH : LOW);
+			dirs=true;
+		}
+	}
+	if(dirs)
+		delay(1);
+}
+
+/*
+	This function copies the positions, velocities and move states of all axes, all taken on the same tick.
+	It never disables interrupts: the ISR publishes each tick into the other half of a double buffer and bumps
+	a sequence count, and the copy is simply retried if the ISR published twice while it was being made.
+	Velocities are converted from each motor's fixed point format and the tick rate to counts/sec after the copy.
+	Nothing is published unless CLEARPATH_SNAPSHOTS is set in ClearPathConfig.h, and it then returns no axes.
+*/
+void ClearPathStepGen::getSnapshot(ClearPathSnapshot& snap)
+{
+#if CLEARPATH_SNAPSHOTS
+	uint8_t seq;
+	do
+	{
+		seq=_snapshotSeq;
+		__asm__ __volatile__("" ::: "memory");		//keep the copy between the two reads of the sequence
+		snap=_snapshots[seq&1];
+		__asm__ __volatile__("" ::: "memory");
+	} while((uint8_t)(_snapshotSeq-seq) > 1);	//the buffer being copied is only rewritten on the 2nd publish
+
+	for(uint8_t i=0;i<snap.numAxis;i++)
+	{
+		//velocity*tickHz, split at the binary point so neither product overflows
+		uint8_t bits=_motors[i]->fractionalBits;
+		long v=snap.velocity[i];
+		unsigned long frac=v&((1L<<bits)-1);
+		snap.velocity[i]=(v>>bits)*(long)_tickHz+(long)((frac*_tickHz)>>bits);
+	}
+#else
+	snap.tick=0;
+	snap.numAxis=0;
+#endif
+}
+
+/*
+	This function returns how many times the ISR ran past the end of its tick.
+	Each overrun delays the next tick, so the motors fall behind the plan unless the step generator degrades.
+*/
+unsigned long ClearPathStepGen::getOverruns()
+{
+	cli();
+	unsigned long count=_overruns;
+	sei();
+	return count;
+}
+
+/*
+	This function sets what happens after an overrun.
+	With maxSteps=0 (the default) nothing changes, the overrun is only counted.
+	Otherwise the step generator degrades: every axis is limited to maxSteps per tick, and ramps wait while
+	steps are held back, so moves are stretched in time instead of the motors falling behind the plan.
+	The limit is lifted once every axis has finished its move.
+	With CLEARPATH_PLAN_TICKS set the ISR does not work out the steps, so it never degrades.
+*/
+void ClearPathStepGen::setDegradedBurst(uint16_t maxSteps)
+{
+	cli();
+	_degradedBurst=maxSteps;
+	sei();
+}
+
+/*
+	This function returns true while the step generator is degraded after an overrun
+*/
+boolean ClearPathStepGen::isDegraded()
+{
+	return _degraded;
+}
+
+/*
+	This function copies the ISR timing into stats, converted to microseconds.
+	Without CLEARPATH_ISR_STATS in ClearPathConfig.h nothing is timed and stats is all zero.
+*/
+void ClearPathStepGen::getISRStats(ClearPathISRStats& stats)
+{
+	memset(&stats,0,sizeof(stats));
+#if CLEARPATH_ISR_STATS
+	cli();
+	stats.samples=_statSamples;
+	stats.minUs=_statMin;
+	stats.maxUs=_statMax;
+	stats.maxLatencyUs=_statMaxLatency;
+	unsigned long sum=_statSum;
+	unsigned long count=_statCount;
+	for(uint8_t i=0;i<CLEARPATH_ISR_STATS_BUCKETS;i++)
+		stats.histogram[i]=_statHistogram[i];
+	sei();
+	if(stats.samples==0)
+		stats.minUs=0;
+	else
+		stats.meanUs=sum/count;
+	//A count is prescale cycles of F_CPU
+	const unsigned long cyclesPerUs=F_CPU/1000000UL;
+	stats.minUs=(unsigned long)stats.minUs*_ops->prescale/cyclesPerUs;
+	stats.maxUs=(unsigned long)stats.maxUs*_ops->prescale/cyclesPerUs;
+	stats.meanUs=(unsigned long)stats.meanUs*_ops->prescale/cyclesPerUs;
+	stats.maxLatencyUs=(unsigned long)stats.maxLatencyUs*_ops->prescale/cyclesPerUs;
+#endif
+}
+
+/*
+	This function clears the ISR timing
+*/
+void ClearPathStepGen::resetISRStats()
+{
+#if CLEARPATH_ISR_STATS
+	cli();
+	_statMin=0xFFFF;
+	_statMax=0;
+	_statMaxLatency=0;
+	_statSum=0;
+	_statCount=0;
+	_statSamples=0;
+	for(uint8_t i=0;i<CLEARPATH_ISR_STATS_BUCKETS;i++)
+		_statHistogram[i]=0;
+	sei();
+#endif
 }
 
 /*	
-	This function sets up the ISR to run at 2kHz if it is passed the value of 249.
+	This function sets up the ISR to run at the tick rate (2kHz unless setTimer() picked another) on its timer.
 	It also, rechecks the direction pins of each connected motor
+	It returns false, and starts nothing, if another step generator is running on the same timer, ie: two left on
+	the default timer.  Give one of them its own timer with setTimer() first.
 */
-void ClearPathStepGen::Start()
+boolean ClearPathStepGen::Start()
 {
-	int time = 249;   //Set Frequency 2kHz
+	if(_ops==0 || (_onTimer[_timer]!=0 && _onTimer[_timer]!=this && _onTimer[_timer]->_running))
+		return false;
 	_SUMPINS=0;
 	for( int i=0; i<_numAxis; i++)
 	{
@@ -291,29 +1142,30 @@ void ClearPathStepGen::Start()
 			_pins[i]=(1<<(_motors[i]->PinB-8));
 		_SUMPINS+=_pins[i];
 	}
+#if CLEARPATH_SNAPSHOTS
+	_tickCount=0;
+#endif
+	resetISRStats();
+#if CLEARPATH_ISR_STATS
+	unsigned long counts=F_CPU/_ops->prescale/_tickHz;
+	for(_statShift=0; ((counts-1)>>_statShift)>7; _statShift++)
+		;
+#endif
 	
 	cli();//stop interrupts
 
-   // set up Timer 1
-   TCCR2A = 0;// set entire TCCR2A register to 0
-  TCCR2B = 0;// same for TCCR2B
-  TCNT2  = 0;//initialize counter value to 0
-
-  //Set compare match register to time
-  OCR2A = time;// time should be 249, 1-256 will produce different frequencies
-
-  // turn on CTC mode
-  TCCR2A |= (1 << WGM21);
-
-  // Set CS21 bit for 8 prescaler
-  TCCR2B = 0;
-  TCCR2B |= (1 << CS01) | (1 << CS00);  
-
-  // enable timer compare interrupt
-  TIMSK2=0;
-  TIMSK2 |= (1 << OCIE2A);
+  // set up the timer for the tick and enable its compare interrupt (see ClearPathTimer.h),
+  // every axis starts active and the first tick drops the idle ones.  When planning ahead the ISR
+  // never looks at the axes, the motors have marked themselves active when given their moves
+  _onTimer[_timer]=this;
+#if !CLEARPATH_PLAN_TICKS
+  _activeAxes=(1<<_numAxis)-1;
+#endif
+  _running=true;
+  _ops->start(_tickHz);
 
   sei();//allow interrupts
+  return true;
 }
 
 /*	
@@ -324,11 +1176,8 @@ void ClearPathStepGen::Start()
 void ClearPathStepGen::Stop()
 {
 	cli();//stop interrupts
-//   
-	// set up Timer 1
-	TCCR2A = 0;// set entire TCCR2A register to 0
-  TCCR2B = 0;// same for TCCR2B
-  TCNT2  = 0;//initialize counter value to 0
+  _ops->stop();
+  _running=false;
 
   sei();//allow interrupts
 }
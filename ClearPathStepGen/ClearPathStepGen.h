@@ -16,20 +16,47 @@
   The motors are pulsed in the background according to move information stored within each motor.
   Only motors of type; ClearPathMotorSD may be used.
 
-  There can only be one instance of Step Controller at any time.
+  Several step generators can run at once, each on its own hardware timer with its own motors and tick rate
+  (see setTimer() and CLEARPATH_TIMERS in ClearPathConfig.h).
 
-  This class uses Timer2, so other functions and classes which use timer 2 will not work correctly ie: tone(), MsTimer2() etc.
+  This class uses Timer2 by default, so other functions and classes which use timer 2 will not work correctly ie: tone(), MsTimer2() etc.
+  CLEARPATH_TIMER in ClearPathConfig.h moves it to Timer1, or Timer3, 4 or 5 on a Mega.
 
   The ISR is set to 2KHz, nominally
 
+  With CLEARPATH_BATCHED_AXES set in ClearPathConfig.h the step controller also keeps the move state of its motors
+  in one contiguous array and updates all of them with a single call per tick, see ClearPathConfig.h
+
   Note: Each attached motor must have its direction/B pin connected to one of pins 8-13
 
   other devices can be connected to pins 8-13 as well
 
  
    Start(time)     - gets Direction pins for all connected motors (make sure all motors have been attached before this is called
-						Configures the ISR to run at 2kHz
+						Configures the ISR to run at 2kHz, returns false if another running step generator has the timer
    Stop() - disables the ISR in this class
+
+   setTimer() - picks the hardware timer and tick rate, call before Start()
+
+   getSnapshot() - copies the position, velocity and move state of every axis, all from the same tick (CLEARPATH_SNAPSHOTS)
+
+   getISRStats() - copies the ISR timing kept when CLEARPATH_ISR_STATS is set in ClearPathConfig.h
+
+   resetISRStats() - clears the ISR timing
+
+   getOverruns() - returns how many times the ISR ran past the end of its tick
+
+   setDegradedBurst() - sets the per tick step limit applied to every axis after an overrun, 0 (default) to never degrade
+
+   isDegraded() - returns true while that limit is applied
+
+   plan() - plans the moves ahead into the tick buffer when CLEARPATH_PLAN_TICKS is set, call it often from loop()
+
+   getUnderruns() - returns how many ticks found the tick buffer empty while a move was still being planned
+
+   moveSync() - moves several motors at once so they all start and finish on the same tick
+
+   moveAll() - starts a move() on several motors at once, all on the same tick
    
  */
 #ifndef ClearPathStepGen_h
@@ -37,6 +64,38 @@
 
 #include "Arduino.h"
 #include "ClearPathMotorSD.h"
+#include "ClearPathTimer.h"
+
+/*
+	A copy of every axis taken on the same tick of the ISR, filled in by ClearPathStepGen::getSnapshot().
+	Entries follow the order the motors were passed to the ClearPathStepGen.
+*/
+struct ClearPathSnapshot
+{
+	unsigned long tick;			// ISR tick the values were taken on, counted from Start()
+	uint8_t numAxis;			// Number of valid entries below
+	long position[6];			// Commanded position in counts, as getCommandedPosition()
+	long velocity[6];			// Commanded velocity in counts/sec, with the same sign as position
+	uint8_t state[6];			// Move state: 3 idle, 1 and 2 ramping, 4 fast move, 5 finishing, 6 playing a ClearPathBurstTable,
+								// 7 following a moveSync()
+};
+
+/*
+	ISR timing filled in by ClearPathStepGen::getISRStats() when CLEARPATH_ISR_STATS is set.
+	Times run from ISR entry to exit.  The histogram splits the tick into 8 buckets (64us each at 2kHz,
+	the last one ends at the end of the tick), and a 9th bucket counts ISRs which overran the tick.
+*/
+#define CLEARPATH_ISR_STATS_BUCKETS 9
+
+struct ClearPathISRStats
+{
+	unsigned long samples;			// Number of ISRs timed since Start() or resetISRStats()
+	uint16_t minUs;					// Shortest ISR
+	uint16_t maxUs;					// Longest ISR
+	uint16_t meanUs;				// Average ISR
+	uint16_t maxLatencyUs;			// Longest delay from the start of a tick to entering the ISR
+	unsigned long histogram[CLEARPATH_ISR_STATS_BUCKETS];
+};
 
 class ClearPathStepGen
 {
@@ -47,10 +106,116 @@ class ClearPathStepGen
   ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* motor2, ClearPathMotorSD* motor3, ClearPathMotorSD* motor4);
   ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* motor2, ClearPathMotorSD* motor3, ClearPathMotorSD* motor4, ClearPathMotorSD* motor5);
   ClearPathStepGen(ClearPathMotorSD* motor1, ClearPathMotorSD* motor2, ClearPathMotorSD* motor3, ClearPathMotorSD* motor4, ClearPathMotorSD* motor5, ClearPathMotorSD* motor6);
-  void Start();
+  boolean Start();
   void Stop();
+  boolean setTimer(uint8_t timer, uint16_t tickHz=CLEARPATH_TICK_HZ);
   int getsum();
+  void getSnapshot(ClearPathSnapshot&);
+  void getISRStats(ClearPathISRStats&);
+  void resetISRStats();
+  unsigned long getOverruns();
+  void setDegradedBurst(uint16_t);
+  boolean isDegraded();
+  uint8_t plan();
+  unsigned long getUnderruns();
+  boolean moveSync(long, long=0, long=0, long=0, long=0, long=0);
+  boolean moveAll(long, long=0, long=0, long=0, long=0, long=0);
+
+  private:
+  friend class ClearPathMotorSD;
+  friend struct ClearPathStepGenISR;
+  void bindAxes();
+  void activate(uint8_t axisBit);
+  void activateNow(uint8_t axisBits);
+  uint8_t acceptAll(long* dist);
+#if CLEARPATH_SYNC_MOVES
+  boolean syncBusy();
+#endif
+  void setDirections(const long* dist, uint8_t axes);
+  boolean queued(uint8_t axisBit);
+  void calcBursts(uint16_t* bursts);
+  boolean tickNeeded();
+#if CLEARPATH_SYNC_MOVES
+  void syncTick();
+#endif
+  void publishSnapshot();
+  void sendPulses(uint16_t* steps);
+  template<uint8_t N> void tick();
+#if CLEARPATH_SPREAD_STEPS
+  void sendSlot();
+  template<uint8_t N> boolean runSlots();
+  template<uint8_t N> boolean startSlots();
+  template<uint8_t N> void slot();
+#endif
 
+  //This returns the move state of an axis, wherever it is kept
+  ClearPathAxisState& axisState(uint8_t i)
+  {
+#if CLEARPATH_BATCHED_AXES
+	return _axes[i];
+#else
+	return *_motors[i];
+#endif
+  }
+
+  static ClearPathStepGen* _onTimer[6];		// The step generator running on each timer, for its ISRs
+
+  // Variables used by the ISR
+  ClearPathMotorSD* _motors[6];					//6 clearpath motor pointers for up to 6 digital pins in PORTB
+  uint8_t _numAxis=0;							//this keeps track of how many pointers are active
+  uint16_t _BurstSteps[6]={0, 0, 0, 0, 0, 0};	//this is the container for the motors to dump however many steps need to be pulsed
+  uint8_t _pins[6]={0, 0, 0, 0, 0, 0};		//This holds the port address (Binary) for each motors Step Pin
+  uint8_t _SUMPINS=0;							//This holds the Binary Sum of all active motor Step Pin addresses
+  uint8_t _OutputBits;						//this is the container to write to output PORTB
+  boolean _flag=false;						//This is the flag to show when to finish pulsing the motors
+  volatile uint8_t _activeAxes=0;			//A bit for each axis with a command, the ISR skips the others
+  boolean _running=false;						//True between Start() and Stop()
+  uint8_t _timer=CLEARPATH_TIMER;				//The hardware timer this step generator runs on...
+  uint16_t _tickHz=CLEARPATH_TICK_HZ;			//...and its tick rate
+  const ClearPathTimerOps* _ops;				//Reaches that timer from outside the ISR
+#if CLEARPATH_BATCHED_AXES
+  ClearPathAxisState _axes[6];				//The move state of every motor, updated together by the ISR
+#endif
+#if CLEARPATH_SYNC_MOVES
+  ClearPathAxisState _sync;					//The lead of a moveSync(), a move no motor makes which the others follow...
+  uint8_t _syncLead=0;						//...worked out in the format of this motor, the one with the longest move
+#endif
+#if CLEARPATH_SNAPSHOTS
+  ClearPathSnapshot _snapshots[2];			//Double buffer the ISR publishes the axis state through
+  volatile uint8_t _snapshotSeq=0;			//Count of published snapshots, the newest is _snapshots[_snapshotSeq&1]
+  unsigned long _tickCount=0;					//Number of ticks since Start()
+#endif
+  unsigned long _overruns=0;					//Number of ticks the ISR ran past
+  uint16_t _degradedBurst=0;					//Burst cap applied to every axis after an overrun, 0 to never degrade
+  boolean _degraded=false;					//True while the burst cap is applied
+#if CLEARPATH_SPREAD_STEPS
+  uint16_t _SlotSteps[6];						//Steps each axis sends in the current slot
+  uint16_t _SlotQuot[6];						//Whole steps each axis sends every slot this tick...
+  uint8_t _SlotRem[6];						//...plus this many more spread over the slots
+  uint8_t _SlotAcc[6];						//Spreads the remainder, a step is added each time it passes _slots
+  uint8_t _slots=0;							//Number of slots this tick
+  uint8_t _slot=0;							//Next slot to send
+  uint16_t _slotLen;							//Timer counts from one slot to the next
+#endif
+#if CLEARPATH_PLAN_TICKS
+  uint16_t _plan[CLEARPATH_PLAN_TICKS][6];		//Steps of each axis for the ticks planned ahead, a ring buffer...
+  volatile uint8_t _planHead=0;				//...the ISR sends this tick next...
+  volatile uint8_t _planTail=0;				//...and plan() fills this one next, it is empty when they are equal
+  uint8_t _planQueued[6]={0, 0, 0, 0, 0, 0};	//Number of planned ticks with steps for each axis, not yet sent
+  unsigned long _underruns=0;					//Number of ticks which found nothing planned while an axis was active
+#endif
+#if CLEARPATH_ISR_STATS
+  // ISR timing, in counts of the tick timer (2us each for Timer2 at 16MHz). The timer restarts from 0 on every
+  // tick, so reading it on entry and exit gives the time into the tick directly.
+  uint16_t _statMin=0xFFFF;			//Shortest ISR
+  uint16_t _statMax=0;				//Longest ISR
+  uint16_t _statMaxLatency=0;		//Longest time from the start of the tick to entering the ISR
+  unsigned long _statSum=0;			//Sum of the ISR times...
+  unsigned long _statCount=0;		//...over this many ISRs, both halved when the sum gets large
+  unsigned long _statSamples=0;		//Number of ISRs timed
+  unsigned long _statHistogram[CLEARPATH_ISR_STATS_BUCKETS];
+  uint8_t _statShift=0;				//Shifts a time into the tick into one of the first 8 buckets
+#endif
 
 };
 #endif
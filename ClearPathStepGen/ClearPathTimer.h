@@ -0,0 +1,137 @@
+/*
+  ClearPathTimer.h - Hardware timers the ClearPath step generator can run on- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*
+  ClearPathTimer<N> drives hardware timer N for a ClearPathStepGen.  Every timer has the same interface,
+  so the ISRs are written once as templates and instantiated for each timer in CLEARPATH_TIMERS
+  (see ClearPathConfig.h).  Code outside the ISRs reaches the timer through a ClearPathTimerOps.
+
+  The A compare of the timer sets the tick (CTC mode), and the B compare is left free for timing
+  within a tick.  Timer2 is an 8 bit timer counting at F_CPU/32 (2us at 16MHz, so ticks of 1954Hz and up),
+  Timer1, 3, 4 and 5 are 16 bit timers counting at F_CPU/8 (0.5us at 16MHz, ticks of 31Hz and up).
+
+  The functions of a ClearPathTimer are:
+
+   start() - sets up a tick of the given rate in Hz and enables its interrupt, call with interrupts off
+
+   stop() - stops the timer
+
+   count() - returns the time into the current tick, in counts
+
+   top() - returns the last count of a tick, a tick is top()+1 counts
+
+   tickPending() - returns true if a tick is due which has not been handled, ie: the ISR overran
+
+   enableTick(), disableTick() - turn the tick interrupt on and off
+
+   setSlot() - sets the B compare to a count, clearing any earlier match
+
+   enableSlot(), disableSlot() - turn the B compare interrupt on and off
+
+   PRESCALE - the clock divider, so a count is PRESCALE/F_CPU seconds
+
+   MAX_COUNTS - the longest tick, in counts
+ */
+#ifndef ClearPathTimer_h
+#define ClearPathTimer_h
+#include "Arduino.h"
+#include "ClearPathConfig.h"
+
+template<uint8_t N> struct ClearPathTimer;
+
+// The parts of a ClearPathTimer used outside of its ISRs, so a step generator can pick its timer at run time
+struct ClearPathTimerOps
+{
+	void (*start)(uint16_t tickHz);
+	void (*stop)();
+	void (*enableTick)();
+	uint16_t prescale;
+	unsigned long maxCounts;
+};
+
+template<uint8_t N> const ClearPathTimerOps* clearPathTimerOps()
+{
+	static const ClearPathTimerOps ops = { &ClearPathTimer<N>::start, &ClearPathTimer<N>::stop,
+		&ClearPathTimer<N>::enableTick, ClearPathTimer<N>::PRESCALE, ClearPathTimer<N>::MAX_COUNTS };
+	return &ops;
+}
+
+#if defined(TCCR2A)
+template<> struct ClearPathTimer<2>
+{
+	typedef uint8_t count_t;
+	static const uint16_t PRESCALE = 32;
+	static const unsigned long MAX_COUNTS = 256;
+
+	static inline void start(uint16_t tickHz)
+	{
+		TCCR2A = 0;							// set entire TCCR2A register to 0
+		TCCR2B = 0;							// same for TCCR2B
+		TCNT2  = 0;							// initialize counter value to 0
+		OCR2A = F_CPU/PRESCALE/tickHz-1;	// 249 for 2kHz at 16MHz
+		TCCR2A |= (1 << WGM21);				// turn on CTC mode
+		TCCR2B |= (1 << CS21) | (1 << CS20);	// 32 prescaler
+		TIMSK2 = (1 << OCIE2A);				// enable timer compare interrupt
+	}
+	static inline void stop() { TCCR2A = 0; TCCR2B = 0; TCNT2 = 0; }
+	static inline count_t count() { return TCNT2; }
+	static inline count_t top() { return OCR2A; }
+	static inline boolean tickPending() { return TIFR2 & (1 << OCF2A); }
+	static inline void enableTick() { TIMSK2 |= (1 << OCIE2A); }
+	static inline void disableTick() { TIMSK2 &= ~(1 << OCIE2A); }
+	static inline void setSlot(count_t c) { OCR2B = c; TIFR2 = (1 << OCF2B); }
+	static inline void enableSlot() { TIMSK2 |= (1 << OCIE2B); }
+	static inline void disableSlot() { TIMSK2 &= ~(1 << OCIE2B); }
+};
+#endif
+
+// The 16 bit timers only differ by number, so one definition serves all of them
+#define CLEARPATH_16BIT_TIMER(n) \
+template<> struct ClearPathTimer<n> \
+{ \
+	typedef uint16_t count_t; \
+	static const uint16_t PRESCALE = 8; \
+	static const unsigned long MAX_COUNTS = 65536; \
+\
+	static inline void start(uint16_t tickHz) \
+	{ \
+		TCCR##n##A = 0; \
+		TCCR##n##B = 0; \
+		TCNT##n  = 0; \
+		OCR##n##A = F_CPU/PRESCALE/tickHz-1;	/* 999 for 2kHz at 16MHz */ \
+		TCCR##n##B |= (1 << WGM##n##2) | (1 << CS##n##1);	/* CTC mode, 8 prescaler */ \
+		TIMSK##n = (1 << OCIE##n##A); \
+	} \
+	static inline void stop() { TCCR##n##A = 0; TCCR##n##B = 0; TCNT##n = 0; } \
+	static inline count_t count() { return TCNT##n; } \
+	static inline count_t top() { return OCR##n##A; } \
+	static inline boolean tickPending() { return TIFR##n & (1 << OCF##n##A); } \
+	static inline void enableTick() { TIMSK##n |= (1 << OCIE##n##A); } \
+	static inline void disableTick() { TIMSK##n &= ~(1 << OCIE##n##A); } \
+	static inline void setSlot(count_t c) { OCR##n##B = c; TIFR##n = (1 << OCF##n##B); } \
+	static inline void enableSlot() { TIMSK##n |= (1 << OCIE##n##B); } \
+	static inline void disableSlot() { TIMSK##n &= ~(1 << OCIE##n##B); } \
+};
+
+#if defined(TCCR1A)
+CLEARPATH_16BIT_TIMER(1)
+#endif
+#if defined(TCCR3A)
+CLEARPATH_16BIT_TIMER(3)
+#endif
+// Timer4 is only the ordinary 16 bit timer on the ATmega1280/2560, the 32U4's Timer4 is a different design
+#if defined(TCCR5A)
+CLEARPATH_16BIT_TIMER(4)
+CLEARPATH_16BIT_TIMER(5)
+#endif
+
+#endif
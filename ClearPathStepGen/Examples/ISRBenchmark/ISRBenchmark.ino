@@ -0,0 +1,275 @@
+/*
+  ISR Benchmark
+  Counts the CPU cycles the step generator's ISR takes per tick, for 1 to 6 moving axes while idle, ramping
+  and cruising at several burst sizes, and the cycles calcSteps() takes in each move state.
+
+  No motors are needed.  The results are printed over Serial as comma separated lines, so a run can be saved
+  and compared with the next one.  It also runs cycle accurately under the simavr simulator, ie:
+
+    arduino-cli compile -b arduino:avr:uno --output-dir build ISRBenchmark
+    simavr -m atmega328p -f 16000000 build/ISRBenchmark.ino.elf
+
+  or -b arduino:avr:mega and -m atmega2560 for a Mega.  The sketch stops the processor when it is done,
+  which also ends simavr.  make -C extras/host (from the library's folder) builds it on a PC for an Uno, and
+  with BOARD=mega for a Mega, to catch compile errors, but only a board or simavr can time it.
+
+  Lines starting with # are comments, the others are:
+
+    config,<mcu>,<F_CPU>,<tick Hz>,<batched>,<interruptible>,<spread steps>
+    calcsteps,<move state>,<calls>,<min cycles>,<mean cycles>,<max cycles>
+    tick,<phase>,<moving axes>,<steps per tick per axis>,<ticks>,<min cycles>,<mean cycles>,<max cycles>
+
+  Tick cycles run from the timer interrupt to the return from the ISR, and are found from the gap the ISR
+  leaves in a loop which keeps reading Timer1, so Timer1 must be free (CLEARPATH_TIMERS without Timer1).
+  The phases are idle (each axis has a command but is disabled, so it is polled and sends nothing),
+  ramp (the start of a slow ramp, 0 or 1 steps per tick) and cruise.
+  With CLEARPATH_SPREAD_STEPS set each slot interrupt is a gap of its own, and is timed as a tick.
+
+ Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+ */
+
+
+
+//Import Required libraries
+#include <avr/sleep.h>
+#include <ClearPathMotorSD.h>
+#include <ClearPathStepGen.h>
+
+#if CLEARPATH_TIMERS & (1<<1)
+#error "ISRBenchmark times the ISR with Timer1, so Timer1 must not be in CLEARPATH_TIMERS"
+#endif
+#if CLEARPATH_PLAN_TICKS
+#error "ISRBenchmark does not call plan(), set CLEARPATH_PLAN_TICKS to 0"
+#endif
+
+#if defined(__AVR_ATmega2560__)
+#define BENCH_MCU "atmega2560"
+#elif defined(__AVR_ATmega328P__)
+#define BENCH_MCU "atmega328p"
+#else
+#define BENCH_MCU "avr"
+#endif
+
+#define BENCH_TICKS 200		// Ticks timed for each line
+#define BENCH_GAP 48			// Gaps in the polling loop longer than this many cycles are ISRs
+
+// initialize six ClearPathMotorSD Motors, one on each pin of PORTB
+ClearPathMotorSD M[6];
+
+//initialize the controller and pass the references to the motors
+ClearPathStepGen machine(&M[0],&M[1],&M[2],&M[3],&M[4],&M[5]);
+
+// a motor which is not passed to the controller, its calcSteps() is called directly
+ClearPathMotorSD Bench;
+
+struct BenchResult
+{
+  unsigned long count;
+  uint16_t minCycles;
+  uint16_t maxCycles;
+  unsigned long sumCycles;
+};
+
+void clearResult(BenchResult& r)
+{
+  r.count=0;
+  r.minCycles=0xFFFF;
+  r.maxCycles=0;
+  r.sumCycles=0;
+}
+
+void addResult(BenchResult& r, uint16_t cycles)
+{
+  r.count++;
+  r.sumCycles+=cycles;
+  if(cycles<r.minCycles)
+    r.minCycles=cycles;
+  if(cycles>r.maxCycles)
+    r.maxCycles=cycles;
+}
+
+void printResult(BenchResult& r)
+{
+  Serial.print(r.count);
+  Serial.print(',');
+  Serial.print(r.count ? r.minCycles : 0);
+  Serial.print(',');
+  Serial.print(r.count ? r.sumCycles/r.count : 0);
+  Serial.print(',');
+  Serial.println(r.maxCycles);
+}
+
+/*
+  Polls Timer1 until n ticks of the step generator have run, and times each from the gap it leaves.
+  The shortest gap seen is one pass of the loop, and is taken off every tick.
+*/
+void timeTicks(unsigned n, BenchResult& r)
+{
+  uint16_t gaps[BENCH_TICKS];
+  uint16_t loopGap=0xFFFF;
+  unsigned count=0;
+  uint8_t timsk0=TIMSK0;
+  Serial.flush();
+  TIMSK0=0;               //No millis() interrupts in the gaps
+  uint16_t last=TCNT1;
+  while(count<n)
+  {
+    uint16_t now=TCNT1;
+    uint16_t gap=now-last;
+    if(gap>BENCH_GAP)
+    {
+      gaps[count++]=gap;
+      now=TCNT1;          //Start again after the bookkeeping
+    }
+    else if(gap<loopGap)
+      loopGap=gap;
+    last=now;
+  }
+  TIMSK0=timsk0;
+  clearResult(r);
+  for(unsigned i=0;i<count;i++)
+    addResult(r, gaps[i]-loopGap);
+}
+
+/*
+  Starts the step generator with the first axes moving, times BENCH_TICKS ticks after settle ms, and prints a line
+*/
+void benchTicks(const char* phase, uint8_t axes, long velMax, long accelMax, boolean enabled, uint16_t burst, unsigned settle)
+{
+  BenchResult r;
+  for(uint8_t i=0;i<6;i++)
+  {
+    M[i].disable();
+    M[i].setMaxVel(velMax);
+    M[i].setMaxAccel(accelMax);
+    if(i<axes)
+    {
+      if(enabled)
+        M[i].enable();
+      M[i].move(1000000);
+    }
+  }
+  machine.Start();
+  delay(settle);
+  timeTicks(BENCH_TICKS, r);
+  machine.Stop();
+
+  Serial.print("tick,");
+  Serial.print(phase);
+  Serial.print(',');
+  Serial.print(axes);
+  Serial.print(',');
+  Serial.print(burst);
+  Serial.print(',');
+  printResult(r);
+}
+
+/*
+  Runs a move on the Bench motor one calcSteps() at a time, timing each call by the move state it ran in
+*/
+void benchCalcSteps()
+{
+#if CLEARPATH_BATCHED_AXES
+  Serial.println("# calcsteps needs CLEARPATH_BATCHED_AXES 0");
+#else
+  BenchResult r[7];
+  for(uint8_t i=0;i<7;i++)
+    clearResult(r[i]);
+
+  cli();
+  uint16_t t0=TCNT1;
+  uint16_t t1=TCNT1;
+  sei();
+  uint16_t overhead=t1-t0;
+
+  Bench.attach(8);
+  Bench.setMaxVel(100000);
+  Bench.setMaxAccel(200000);
+  Bench.enable();
+  Bench.move(20000);
+  for(unsigned calls=0; calls<2000 && !Bench.commandDone(); calls++)
+  {
+    uint8_t state=Bench.moveStateX;
+    cli();
+    t0=TCNT1;
+    Bench.calcSteps();
+    t1=TCNT1;
+    sei();
+    addResult(r[state], t1-t0-overhead);
+  }
+  for(uint8_t i=0;i<20;i++)		//Idle, with no command
+  {
+    cli();
+    t0=TCNT1;
+    Bench.calcSteps();
+    t1=TCNT1;
+    sei();
+    addResult(r[3], t1-t0-overhead);
+  }
+
+  for(uint8_t i=1;i<7;i++)
+  {
+    if(r[i].count==0)
+      continue;
+    Serial.print("calcsteps,");
+    Serial.print(i);
+    Serial.print(',');
+    printResult(r[i]);
+  }
+#endif
+}
+
+// the setup routine runs once when you press reset:
+void setup()
+{
+  Serial.begin(115200);
+
+  //Timer1 counts every cycle
+  TCCR1A=0;
+  TCCR1B=(1<<CS10);
+  TIMSK1=0;
+
+  //Step pins only, the motors never see these pulses
+  for(uint8_t i=0;i<6;i++)
+    M[i].attach(8+i);
+
+  Serial.println("# ClearPath ISR benchmark, all times in CPU cycles");
+  Serial.print("config," BENCH_MCU ",");
+  Serial.print(F_CPU);
+  Serial.print(',');
+  Serial.print(CLEARPATH_TICK_HZ);
+  Serial.print(',');
+  Serial.print(CLEARPATH_BATCHED_AXES);
+  Serial.print(',');
+  Serial.print(CLEARPATH_INTERRUPTIBLE_ISR);
+  Serial.print(',');
+  Serial.println(CLEARPATH_SPREAD_STEPS);
+
+  benchCalcSteps();
+
+  for(uint8_t axes=1;axes<=6;axes++)
+    benchTicks("idle", axes, 100000, 200000, false, 0, 5);
+  for(uint8_t axes=1;axes<=6;axes++)
+    benchTicks("ramp", axes, 100000, 4000, true, 1, 5);
+  //Cruise at 1, 10 and 50 steps per tick, after the 2,000,000 counts/sec/sec ramp up has finished
+  const uint16_t bursts[3]={1, 10, 50};
+  for(uint8_t b=0;b<3;b++)
+    for(uint8_t axes=1;axes<=6;axes++)
+      benchTicks("cruise", axes, (long)bursts[b]*CLEARPATH_TICK_HZ, 2000000, true, bursts[b], 60);
+
+  for(uint8_t i=0;i<6;i++)
+    M[i].disable();
+  Serial.println("# done");
+  Serial.flush();
+
+  //Stop here, simavr exits when the processor sleeps with interrupts off
+  cli();
+  sleep_enable();
+  sleep_cpu();
+}
+
+// the loop routine runs over and over again forever:
+void loop()
+{
+}
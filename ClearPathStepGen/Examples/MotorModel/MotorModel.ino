@@ -0,0 +1,119 @@
+/*
+  Motor Model
+  Works out how long a move takes to finish and settle on a ClearPath motor, for a range of accelerations and
+  RAS settings, with a ClearPathMotorModel standing in for the motor.  No motors or step generator are used:
+  the steps of each tick come straight from calcSteps(), as the ISR would send them.
+
+  Set the move, the motor's own limits, the load's ringing and the settle window below.  For each input shaper
+  (see ClearPathMotorSD::setShaper()), RAS time and acceleration a line is printed with the ticks until the last
+  step is sent, the ticks until the load has settled, and the largest following error, so the fastest settings
+  which keep the error acceptable can be picked before the machine is run.  The shapers are only tried when
+  CLEARPATH_SHAPER_TICKS in ClearPathConfig.h is long enough for MODEL_LOAD_HZ.  Setting MODEL_TRACE to 1 also
+  prints every tick of the first setting, to plot.
+  It runs on a board, under simavr (see ISRBenchmark), or compiled on a PC with a stand in for Arduino.h.
+
+  Lines are comma separated:
+
+    tune,<shaper>,<RAS ms>,<acceleration>,<ticks to send>,<ticks to settle>,<max following error>
+    trace,<tick>,<commanded position>,<modelled position>,<following error>
+
+ Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+ */
+
+
+
+//Import Required libraries
+#include <ClearPathMotorSD.h>
+#include <ClearPathMotorModel.h>
+
+#if CLEARPATH_BATCHED_AXES
+#error "MotorModel runs a motor without a step generator, set CLEARPATH_BATCHED_AXES to 0"
+#endif
+
+#define MODEL_DIST 8000			// The move, in counts...
+#define MODEL_VEL 60000			// ...and its velocity in counts/sec
+#define MODEL_MOTOR_VEL 53333	// The motor's own limits: 4000RPM at 800 counts per revolution...
+#define MODEL_MOTOR_ACCEL 1500000	// ...and the acceleration its torque gives with the load, in counts/sec/sec
+#define MODEL_LOAD_HZ 12.0		// The load rings at this frequency...
+#define MODEL_LOAD_DAMPING 0.05	// ...with this damping ratio
+#define MODEL_WINDOW 2.0		// Settled within this many counts
+#define MODEL_MAX_TICKS 20000UL	// Give up on settling after this many ticks
+#define MODEL_TRACE 0			// 1 prints every tick of the first setting
+
+const uint8_t shapers[]={CLEARPATH_SHAPER_OFF, CLEARPATH_SHAPER_ZV, CLEARPATH_SHAPER_ZVD};
+const char* const shaperNames[]={"off", "zv", "zvd"};
+const uint8_t rasTimes[]={0, 4, 16, 33, 50};
+const long accels[]={100000, 300000, 1000000, 2000000};
+
+/*
+  Runs the move with one shaper, RAS time and acceleration, and prints a line
+*/
+void tune(uint8_t shaper, uint8_t ras, long accelMax, boolean trace)
+{
+  ClearPathMotorSD cmd;
+  ClearPathMotorModel model;
+  model.setRAS(ras);
+  model.setMaxVel(MODEL_MOTOR_VEL);
+  model.setMaxAccel(MODEL_MOTOR_ACCEL);
+  model.setLoad(MODEL_LOAD_HZ, MODEL_LOAD_DAMPING);
+  if(!cmd.setShaper(shaper, MODEL_LOAD_HZ, MODEL_LOAD_DAMPING))
+    return;
+
+  cmd.setMaxVel(MODEL_VEL);
+  cmd.setMaxAccel(accelMax);
+  cmd.enable();
+  cmd.move(MODEL_DIST);
+
+  unsigned long ticks=0;
+  unsigned long sendTicks=0;
+  while(ticks<MODEL_MAX_TICKS && (!cmd.commandDone() || !model.settled(MODEL_WINDOW)))
+  {
+    long steps= cmd.commandDone() ? 0 : cmd.calcSteps();
+    model.tick(MODEL_DIST<0 ? -steps : steps);
+    ticks++;
+    if(!cmd.commandDone())
+      sendTicks=ticks;
+    if(trace)
+    {
+      Serial.print("trace,");
+      Serial.print(ticks);
+      Serial.print(',');
+      Serial.print(model.commanded());
+      Serial.print(',');
+      Serial.print(model.position());
+      Serial.print(',');
+      Serial.println(model.error());
+    }
+  }
+
+  Serial.print("tune,");
+  Serial.print(shaperNames[shaper]);
+  Serial.print(',');
+  Serial.print(ras);
+  Serial.print(',');
+  Serial.print(accelMax);
+  Serial.print(',');
+  Serial.print(sendTicks);
+  Serial.print(',');
+  Serial.print(ticks);
+  Serial.print(',');
+  Serial.println(model.maxError());
+}
+
+// the setup routine runs once when you press reset:
+void setup()
+{
+  Serial.begin(115200);
+
+  for(uint8_t s=0;s<sizeof(shapers);s++)
+    for(uint8_t r=0;r<sizeof(rasTimes);r++)
+      for(uint8_t a=0;a<sizeof(accels)/sizeof(accels[0]);a++)
+        tune(shapers[s], rasTimes[r], accels[a], MODEL_TRACE && s==0 && r==0 && a==0);
+  Serial.flush();
+}
+
+// the loop routine runs over and over again forever:
+void loop()
+{
+}
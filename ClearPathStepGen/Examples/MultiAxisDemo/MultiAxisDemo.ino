@@ -2,7 +2,8 @@
   Multi Axis Axample
   Runs 3 a Teknic ClearPath SDSK or SDHP motors
   
-  the motors cycle forward taking turns starting with X, then both X and Y, then X, Y, and Z
+  the motors cycle forward taking turns starting with X, then both X and Y, then X, Y, and Z,
+  then all three make a synchronized move out and back, starting and finishing together
  
  
  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
@@ -41,7 +42,7 @@ void setup()
   Z.setMaxVel(100000);
   Z.setMaxAccel(4000);
   
-// Enable motors, reset each motors position to 0  
+// Enable motors, each keeps its commanded position (call setPosition(0) to zero a motor where it is)
 X.enable();
 Y.enable();
 Z.enable();
@@ -105,6 +106,17 @@ void loop()
    while(!Z.commandDone()||!Z.readHLFB()||!Y.commandDone()||!Y.readHLFB()||!X.commandDone()||!X.readHLFB())
    { }
    
-   
+// Move X forward 20,000, Y back 10,000 and Z forward 5,000 counts, all finishing on the same tick.
+// Z's low acceleration sets the pace, X and Y are slowed to match
+   machine.moveSync(20000, -10000, 5000);
+   Serial.println("Synchronized Move");
+   while(!Z.commandDone()||!Z.readHLFB()||!Y.commandDone()||!Y.readHLFB()||!X.commandDone()||!X.readHLFB())
+   { }
+
+// and back again
+   machine.moveSync(-20000, 10000, -5000);
+   Serial.println("Synchronized Move");
+   while(!Z.commandDone()||!Z.readHLFB()||!Y.commandDone()||!Y.readHLFB()||!X.commandDone()||!X.readHLFB())
+   { }
    
 }
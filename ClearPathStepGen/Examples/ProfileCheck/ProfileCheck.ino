@@ -0,0 +1,708 @@
+/*
+  Profile Check
+  Checks the steps calcSteps() sends for a sweep of moves against stored golden traces, so a change to the
+  move calculations which changes a single step, or the length of a move by a single tick, is caught.
+
+  Every move is run on a fresh motor one calcSteps() at a time, no motors or ISR are used, and each is checked for:
+    - the exact final position, the motor never passes the target, and never steps backwards
+    - no tick sends more than the maximum steps per tick
+    - the move finishes
+  The moves of a grid of distances, velocities and accelerations, in Q22.10 and Q18.14, are also compared with
+  ProfileGolden.h: the number of ticks and a CRC of the steps sent on every tick.  A further 2000 moves picked
+  at random are only checked for the above.
+
+  Last, random sequences of move(), moveFast(), moveTo(), stopMove(), setMaxVel(), setMaxAccel(),
+  setFastStepsPerTick(), setPosition(), setSoftLimits(), clearSoftLimits(), recordMove(), playMove(), enable() and
+  disable(), with a random number of ticks after each, are run on a motor and checked on every tick:
+    - no tick sends more than the maximum steps per tick, more than one count per tick over the velocity limit
+      (plus one for rounding) during a move(), or more than the fast steps per tick during a moveFast()
+    - no move passes its target, and every move which is not stopped sends exactly its distance
+    - a move sends the same steps on every tick as the same move on a fresh motor, so nothing is carried over
+      from the moves before it
+    - the commanded position counts every step in the direction of its move, from the last setPosition()
+    - a move past a soft limit is rejected or clipped to it, no step is sent past a limit, and a move the ISR
+      ends at a limit ends on it
+    - the motor finishes its last command once enabled
+  A sequence which fails is shrunk, by dropping every command it still fails without, and printed so it can
+  be added to profileRegressions[] below.  The sequences in profileRegressions[] are run first, every time.
+
+  To add a regression case:
+    1. Run the check, ie: make -C extras/host ProfileCheck (see below), and take the fail,sequence line.
+    2. Everything after its reason is the sequence, each entry a {command, value, ticks to run after it}.
+       Paste it as a new line at the end of profileRegressions[], after a comma on the line before, under a
+       comment saying what went wrong.  Its {PROFILE_END,10,0} or {PROFILE_END,14,0} picks the format.
+    3. A case found another way is written the same way by hand, using the commands in the enum below.
+    4. Run it once without the fix to see it fail, and again with the fix.  The summary counts one more
+       sequence for each case added.
+
+  The results are printed over Serial, one line per failure and a summary.  Like ISRBenchmark it also runs
+  under the simavr simulator:
+
+    arduino-cli compile -b arduino:avr:mega --output-dir build ProfileCheck
+    simavr -m atmega2560 -f 16000000 build/ProfileCheck.ino.elf
+
+  or on a PC with g++, where it takes a few seconds and needs no board or simulator:
+
+    make -C extras/host ProfileCheck		(from the library's folder, or BOARD=mega for a Mega)
+
+  When the move calculations are meant to change, set PROFILE_RECORD to 1 below, run it once, and paste
+  what it prints over ProfileGolden.h.
+
+  Lines are comma separated:
+
+    fail,<format>,<distance>,<velocity>,<acceleration>,<ticks>,<crc>,<reason>
+    fail,sequence,<format>,<reason>,<the shrunk sequence, as entries of profileRegressions[]>
+    summary,<moves and sequences>,<failures>
+
+ Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+ */
+
+
+
+//Import Required libraries
+#include <ClearPathMotorSD.h>
+#include "ProfileGolden.h"
+
+#if CLEARPATH_BATCHED_AXES
+#error "ProfileCheck runs motors without a step generator, set CLEARPATH_BATCHED_AXES to 0"
+#endif
+
+#define PROFILE_RECORD 0			// 1 prints a new ProfileGolden.h instead of checking against it
+#define PROFILE_RANDOM_MOVES 2000	// Moves picked at random, after the grid
+#define PROFILE_MAX_TICKS 200000UL	// A move still running after this many ticks has failed to finish
+#define PROFILE_SEQUENCES 300		// Random command sequences, after the random moves
+#define PROFILE_SEQUENCE_OPS 12		// Commands in each random sequence
+#define PROFILE_TABLE_RUNS 100		// Runs of the table a sequence records into
+
+const long gridDist[]={1, 2, 3, 5, 10, 37, 100, 1000, 12345, 50000};
+const long gridVel[]={2000, 5000, 20000, 60000, 100000};
+const long gridAccel[]={4000, 50000, 200000, 2000000};
+#define GRID_DIST (sizeof(gridDist)/sizeof(gridDist[0]))
+#define GRID_VEL (sizeof(gridVel)/sizeof(gridVel[0]))
+#define GRID_ACCEL (sizeof(gridAccel)/sizeof(gridAccel[0]))
+#define GRID_MOVES (GRID_DIST*GRID_VEL*GRID_ACCEL)
+
+// The commands of a sequence
+enum
+{
+  PROFILE_MOVE,		// move(value)
+  PROFILE_FAST,		// moveFast(value)
+  PROFILE_STOP,		// stopMove()
+  PROFILE_VEL,		// setMaxVel(value)
+  PROFILE_ACCEL,	// setMaxAccel(value)
+  PROFILE_ENABLE,	// enable()
+  PROFILE_DISABLE,	// disable()
+  PROFILE_FAST_STEPS,	// setFastStepsPerTick(value)
+  PROFILE_MOVE_TO,	// moveTo(value)
+  PROFILE_SET_POSITION,	// setPosition(value)
+  PROFILE_SOFT_LIMITS,	// setSoftLimits(-|value|,|value|), clipping if value is negative, or clearSoftLimits() if 0
+  PROFILE_RECORD_MOVE,	// recordMove(table, value)
+  PROFILE_PLAY_MOVE,	// playMove(table)
+  PROFILE_END		// ends a sequence of profileRegressions[], run in Q22.10 if value is 10, Q18.14 if 14
+};
+
+// A command, followed by ticks calls to calcSteps()
+struct ProfileOp
+{
+  uint8_t op;
+  long value;
+  uint16_t ticks;
+};
+
+// Sequences which failed once, each shrunk to the commands the failure needed
+const ProfileOp profileRegressions[] PROGMEM = {
+  //A short move at a high acceleration went one tick past half way and passed its target
+  {PROFILE_ACCEL,1631540,65},{PROFILE_ENABLE,0,852},{PROFILE_VEL,69798,125},{PROFILE_MOVE,2,185},{PROFILE_END,10,0},
+  {PROFILE_VEL,38847,90},{PROFILE_ACCEL,1853633,1604},{PROFILE_ENABLE,0,49},{PROFILE_MOVE,-4,198},{PROFILE_END,10,0},
+  //Only the first move of a motor went past half way, so later moves took a different number of ticks
+  {PROFILE_ACCEL,1287444,117},{PROFILE_ENABLE,0,124},{PROFILE_VEL,98105,7},{PROFILE_MOVE,-57,21},{PROFILE_MOVE,-4169,147},{PROFILE_END,10,0},
+  {PROFILE_ACCEL,1541753,114},{PROFILE_ENABLE,0,50},{PROFILE_VEL,71039,199},{PROFILE_MOVE,-20,157},{PROFILE_MOVE,6,94},{PROFILE_END,10,0},
+  //A new acceleration or velocity during a move cut the ramp down short, and the rest of the move went out in one tick
+  {PROFILE_VEL,25890,7},{PROFILE_ACCEL,536794,396},{PROFILE_ENABLE,0,155},{PROFILE_MOVE,2945,138},{PROFILE_ACCEL,1092230,70},{PROFILE_END,10,0},
+  {PROFILE_ACCEL,587412,177},{PROFILE_ENABLE,0,195},{PROFILE_VEL,9831,14},{PROFILE_MOVE,-2787,94},{PROFILE_ACCEL,1555066,31},{PROFILE_END,14,0},
+  {PROFILE_VEL,96077,43},{PROFILE_ACCEL,700673,54},{PROFILE_ENABLE,0,97},{PROFILE_MOVE,-3481,45},{PROFILE_VEL,2298,117},{PROFILE_END,14,0},
+  //moveFast() sent the whole move at the maximum steps per tick instead of 50 counts per tick
+  {PROFILE_FAST,599,99},{PROFILE_END,10,0},
+  {PROFILE_ENABLE,0,0},{PROFILE_FAST_STEPS,7,0},{PROFILE_FAST,-1000,30},{PROFILE_FAST_STEPS,300,20},{PROFILE_END,14,0},
+  //The commanded position counted down for a positive move, and enable() set it back to 0
+  {PROFILE_VEL,20000,0},{PROFILE_ACCEL,200000,0},{PROFILE_ENABLE,0,0},{PROFILE_MOVE,100,100},{PROFILE_END,10,0},
+  {PROFILE_VEL,20000,0},{PROFILE_ACCEL,200000,0},{PROFILE_ENABLE,0,0},{PROFILE_MOVE_TO,-300,300},{PROFILE_DISABLE,0,0},
+  {PROFILE_ENABLE,0,0},{PROFILE_MOVE_TO,-100,300},{PROFILE_SET_POSITION,5000,0},{PROFILE_MOVE_TO,4900,300},{PROFILE_END,14,0},
+  //Moves past a soft limit rejected, clipped, and ended by the ISR when the limits change during the move
+  {PROFILE_VEL,20000,0},{PROFILE_ACCEL,200000,0},{PROFILE_ENABLE,0,0},{PROFILE_SOFT_LIMITS,500,0},{PROFILE_MOVE,600,300},
+  {PROFILE_MOVE_TO,-500,300},{PROFILE_END,10,0},
+  {PROFILE_VEL,46695,107},{PROFILE_ACCEL,560503,129},{PROFILE_SOFT_LIMITS,-13,145},{PROFILE_ENABLE,0,82},{PROFILE_MOVE,14,78},{PROFILE_END,10,0},
+  {PROFILE_VEL,57198,114},{PROFILE_ACCEL,1587185,130},{PROFILE_MOVE,4083,198},{PROFILE_SOFT_LIMITS,-1077,174},{PROFILE_ENABLE,0,1324},{PROFILE_END,14,0},
+  //A table recorded next to a soft limit was cut short at the limit, and played elsewhere it came up short
+  {PROFILE_VEL,20000,0},{PROFILE_ACCEL,200000,0},{PROFILE_ENABLE,0,0},{PROFILE_SOFT_LIMITS,500,0},{PROFILE_RECORD_MOVE,2000,0},
+  {PROFILE_SET_POSITION,-5000,0},{PROFILE_PLAY_MOVE,0,300},{PROFILE_END,10,0}
+};
+
+unsigned long moves=0;
+unsigned long failures=0;
+
+struct ProfileResult
+{
+  unsigned long ticks;
+  uint16_t crc;
+  const char* fault;		// 0 if the move passed every check
+};
+
+// CRC-16-CCITT of one more byte
+uint16_t crcByte(uint16_t crc, uint8_t b)
+{
+  crc^=(uint16_t)b<<8;
+  for(uint8_t i=0;i<8;i++)
+    crc= (crc & 0x8000) ? (crc<<1)^0x1021 : crc<<1;
+  return crc;
+}
+
+/*
+  Runs a move of dist counts on a fresh motor of type Motor, checking it as it goes
+*/
+template<class Motor> void runMove(long dist, long velMax, long accelMax, ProfileResult& r)
+{
+  Motor m;
+  m.setMaxVel(velMax);
+  m.setMaxAccel(accelMax);
+  m.enable();
+  m.move(dist);
+
+  long target= dist<0 ? -dist : dist;
+  long sent=0;
+  long lastPos=m.getCommandedPosition();
+  int dir=0;
+  r.ticks=0;
+  r.crc=0xFFFF;
+  r.fault=0;
+  while(!m.commandDone())
+  {
+    if(r.ticks>=PROFILE_MAX_TICKS)
+    {
+      r.fault="unfinished";
+      return;
+    }
+    int steps=m.calcSteps();
+    r.ticks++;
+    r.crc=crcByte(r.crc, steps);
+    r.crc=crcByte(r.crc, steps>>8);
+    if(steps<0 || steps>255)
+      r.fault="burst";
+    sent+=steps;
+    if(sent>target && !r.fault)
+      r.fault="overshoot";
+    long pos=m.getCommandedPosition();
+    int d= pos>lastPos ? 1 : pos<lastPos ? -1 : 0;
+    if(d!=0)
+    {
+      if(dir!=0 && d!=dir && !r.fault)
+        r.fault="reversed";
+      dir=d;
+    }
+    lastPos=pos;
+  }
+  if(!r.fault && (sent!=target || m.getCommandedPosition()!=dist))
+    r.fault="position";
+}
+
+void runMove(uint8_t format, long dist, long velMax, long accelMax, ProfileResult& r)
+{
+  if(format==14)
+    runMove<ClearPathMotorSDQ<14> >(dist, velMax, accelMax, r);
+  else
+    runMove<ClearPathMotorSD>(dist, velMax, accelMax, r);
+}
+
+void report(uint8_t format, long dist, long velMax, long accelMax, ProfileResult& r, const char* fault)
+{
+  moves++;
+  if(!fault)
+    return;
+  failures++;
+  Serial.print("fail,Q");
+  Serial.print(format);
+  Serial.print(',');
+  Serial.print(dist);
+  Serial.print(',');
+  Serial.print(velMax);
+  Serial.print(',');
+  Serial.print(accelMax);
+  Serial.print(',');
+  Serial.print(r.ticks);
+  Serial.print(',');
+  Serial.print(r.crc);
+  Serial.print(',');
+  Serial.println(fault);
+}
+
+/*
+  Runs the grid in both formats, checking each move against its golden trace or printing the traces
+*/
+void checkGrid()
+{
+#if PROFILE_RECORD
+  Serial.println("// Golden traces for ProfileCheck.ino, made with PROFILE_RECORD set to 1");
+  Serial.println("// Each entry is {ticks, crc} for one move of the grid, distance slowest and acceleration fastest");
+  Serial.println("struct ProfileGolden { uint16_t ticks; uint16_t crc; };");
+  Serial.print("const ProfileGolden profileGolden[2][");
+  Serial.print(GRID_MOVES);
+  Serial.println("] PROGMEM = {");
+#endif
+  const uint8_t formats[2]={10, 14};
+  for(uint8_t f=0;f<2;f++)
+  {
+#if PROFILE_RECORD
+    Serial.println(" {");
+#endif
+    uint16_t i=0;
+    for(uint8_t d=0;d<GRID_DIST;d++)
+      for(uint8_t v=0;v<GRID_VEL;v++)
+        for(uint8_t a=0;a<GRID_ACCEL;a++,i++)
+        {
+          ProfileResult r;
+          runMove(formats[f], gridDist[d], gridVel[v], gridAccel[a], r);
+#if PROFILE_RECORD
+          Serial.print("  {");
+          Serial.print(r.ticks);
+          Serial.print(", ");
+          Serial.print(r.crc);
+          Serial.println("},");
+          report(formats[f], gridDist[d], gridVel[v], gridAccel[a], r, r.fault);
+#else
+          const char* fault=r.fault;
+          if(!fault && (r.ticks!=pgm_read_word(&profileGolden[f][i].ticks) || r.crc!=pgm_read_word(&profileGolden[f][i].crc)))
+            fault="golden";
+          report(formats[f], gridDist[d], gridVel[v], gridAccel[a], r, fault);
+#endif
+        }
+#if PROFILE_RECORD
+    Serial.println(" },");
+#endif
+  }
+#if PROFILE_RECORD
+  Serial.println("};");
+#endif
+}
+
+/*
+  Runs moves picked at random, checking only that each is correct
+*/
+void checkRandom()
+{
+  uint32_t seed=2463534242UL;
+  for(unsigned n=0;n<PROFILE_RANDOM_MOVES;n++)
+  {
+    //xorshift32
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    uint8_t format= (seed & 1) ? 14 : 10;
+    long dist=(long)(seed>>8)%30000+1;
+    if(seed & 2)
+      dist=-dist;
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    long velMax=2000+(long)(seed%98001);
+    long accelMax=4000+(long)((seed>>12)%1996001);
+    ProfileResult r;
+    runMove(format, dist, velMax, accelMax, r);
+    report(format, dist, velMax, accelMax, r, r.fault);
+  }
+}
+
+// The move a sequence is making, and what has been checked of it
+struct SequenceState
+{
+  boolean moving;		// A move is being checked...
+  boolean fast;			// ...made by moveFast()...
+  boolean clean;		// ...started on an enabled motor with its limits set, and none changed since
+  boolean enabled;
+  long dist;
+  long target;
+  long sent;
+  long position;		// Commanded position the motor should have
+  long limit;			// Soft limits of -limit to limit, 0 for none...
+  boolean limitClip;	// ...clipping moves past them
+  unsigned long limitStops;
+  long tableDist;		// Move recorded in the table, 0 for none...
+  long tableBound;		// ...and the most steps per tick it may send
+  long velMax;			// Limits set on the motor
+  long accelMax;
+  long fastSteps;
+  long moveVel;			// Limits when the move started
+  long moveAccel;
+  long velBound;		// Most steps per tick the move may send
+  ProfileResult r;		// Ticks and CRC of the move so far, and the first fault of the sequence
+};
+
+long velBound(long velMax)
+{
+  long n=velMax/CLEARPATH_TICK_HZ;
+  return (n<51 ? n : 50)+2;
+}
+
+/*
+  Sends one tick of a sequence and checks it, and checks a move which has just finished against a fresh motor
+*/
+template<class Motor> void sequenceTick(Motor& m, SequenceState& s)
+{
+  int steps=m.calcSteps();
+  if((steps<0 || steps>255) && !s.r.fault)
+    s.r.fault="burst";
+  s.position+= s.dist<0 ? -steps : steps;
+  if(m.getCommandedPosition()!=s.position && !s.r.fault)
+    s.r.fault="position";
+  if(s.limit && steps && (s.dist<0 ? s.position<-s.limit : s.position>s.limit) && !s.r.fault)
+    s.r.fault="limit";
+  if(m.getLimitStops()!=s.limitStops)
+  {
+    //The ISR ended the move, on the limit unless it was already past it
+    s.limitStops=m.getLimitStops();
+    if((!s.limit || (steps && s.position!=(s.dist<0 ? -s.limit : s.limit))) && !s.r.fault)
+      s.r.fault="limit";
+    s.moving=false;
+  }
+  if(!s.moving)
+    return;
+  s.r.ticks++;
+  s.r.crc=crcByte(s.r.crc, steps);
+  s.r.crc=crcByte(s.r.crc, steps>>8);
+  s.sent+=steps;
+  if(s.sent>s.target && !s.r.fault)
+    s.r.fault="overshoot";
+  if(steps>s.velBound && !s.r.fault)
+    s.r.fault="velocity";
+  if(m.commandDone())
+  {
+    s.moving=false;
+    if(s.sent!=s.target && !s.r.fault)
+      s.r.fault="lost";
+    if(s.clean && !s.fast && !s.r.fault)
+    {
+      ProfileResult fresh;
+      runMove<Motor>(s.dist, s.moveVel, s.moveAccel, fresh);
+      if((fresh.ticks!=s.r.ticks || fresh.crc!=s.r.crc))
+        s.r.fault="history";
+    }
+  }
+}
+
+/*
+  Runs n commands on a fresh motor of type Motor, and returns the first fault, or 0 if it passed every check
+*/
+template<class Motor> const char* runSequence(const ProfileOp* ops, uint8_t n)
+{
+  Motor m;
+  SequenceState s;
+  s.moving=false;
+  s.enabled=false;
+  s.dist=0;
+  s.position=0;
+  s.limit=0;
+  s.limitClip=false;
+  s.limitStops=0;
+  s.tableDist=0;
+  ClearPathBurstRun runs[PROFILE_TABLE_RUNS];
+  ClearPathBurstTable table(runs, PROFILE_TABLE_RUNS);
+  s.velMax=0;
+  s.accelMax=0;
+  s.fastSteps=50;
+  s.r.fault=0;
+  for(uint8_t i=0;i<n && !s.r.fault;i++)
+  {
+    long v=ops[i].value;
+    switch(ops[i].op)
+    {
+      case PROFILE_MOVE:
+      case PROFILE_FAST:
+      case PROFILE_MOVE_TO:
+      {
+        //The move the soft limits should leave, 0x7FFFFFFF if they should reject it
+        long want= ops[i].op==PROFILE_MOVE_TO ? v-s.position : v;
+        long end=s.position+want;
+        if(!s.limit || (want>0 ? end<=s.limit : end>=-s.limit))
+          ;
+        else if(!s.limitClip)
+          want=0x7FFFFFFF;
+        else if(want>0)
+          want= s.position<s.limit ? s.limit-s.position : 0;
+        else
+          want= s.position>-s.limit ? -s.limit-s.position : 0;
+        boolean accepted= ops[i].op==PROFILE_MOVE ? m.move(v) : ops[i].op==PROFILE_FAST ? m.moveFast(v) : m.moveTo(v);
+        if(accepted && want==0x7FFFFFFF && !s.r.fault)
+          s.r.fault="limit";
+        if(accepted)
+        {
+          v=want;
+          s.moving= v!=0;		//A move of 0 is done at once
+          s.fast= ops[i].op==PROFILE_FAST;
+          s.clean=s.enabled && s.velMax!=0 && s.accelMax!=0;
+          s.dist=v;
+          s.target= v<0 ? -v : v;
+          s.sent=0;
+          s.moveVel=s.velMax;
+          s.moveAccel=s.accelMax;
+          s.velBound= s.fast ? s.fastSteps : velBound(s.velMax);
+          s.r.ticks=0;
+          s.r.crc=0xFFFF;
+        }
+        break;
+      }
+      case PROFILE_STOP:
+        m.stopMove();
+        s.moving=false;
+        break;
+      case PROFILE_VEL:
+        m.setMaxVel(v);
+        s.velMax=v;
+        s.clean=false;
+        break;
+      case PROFILE_FAST_STEPS:
+        m.setFastStepsPerTick(v);
+        s.fastSteps=v;
+        if(s.fast && v>s.velBound)
+          s.velBound=v;
+        break;
+      case PROFILE_ACCEL:
+        m.setMaxAccel(v);
+        s.accelMax=v;
+        s.clean=false;
+        break;
+      case PROFILE_ENABLE:
+        m.enable();
+        s.enabled=true;
+        break;
+      case PROFILE_DISABLE:
+        m.disable();
+        s.enabled=false;
+        s.moving=false;
+        break;
+      case PROFILE_SET_POSITION:
+        m.setPosition(v);
+        s.position=v;
+        break;
+      case PROFILE_RECORD_MOVE:
+        s.tableDist= m.recordMove(table, v) ? v : 0;
+        s.tableBound=velBound(s.velMax);
+        break;
+      case PROFILE_PLAY_MOVE:
+      {
+        //A table is never clipped, so a move past a soft limit is rejected
+        long end=s.position+s.tableDist;
+        boolean allowed= !s.limit || (s.tableDist>0 ? end<=s.limit : end>=-s.limit);
+        boolean done=m.commandDone();
+        boolean accepted=m.playMove(table);
+        if(done && accepted!=(s.tableDist!=0 && allowed) && !s.r.fault)
+          s.r.fault="limit";
+        if(accepted)
+        {
+          //The table must send exactly its distance, whatever the motor's limits were when it was recorded
+          s.moving=true;
+          s.fast=false;
+          s.clean=false;
+          s.dist=s.tableDist;
+          s.target= s.tableDist<0 ? -s.tableDist : s.tableDist;
+          s.sent=0;
+          s.velBound=s.tableBound;
+          s.r.ticks=0;
+          s.r.crc=0xFFFF;
+        }
+        break;
+      }
+      case PROFILE_SOFT_LIMITS:
+        if(v)
+          m.setSoftLimits(v<0 ? v : -v, v<0 ? -v : v, v<0);
+        else
+          m.clearSoftLimits();
+        s.limit= v<0 ? -v : v;
+        s.limitClip= v<0;
+        break;
+    }
+    for(uint16_t t=0;t<ops[i].ticks && !s.r.fault;t++)
+      sequenceTick(m, s);
+  }
+  //Finish the last command
+  m.enable();
+  for(unsigned long t=0;!m.commandDone() && !s.r.fault;t++)
+  {
+    if(t>=PROFILE_MAX_TICKS)
+      s.r.fault="unfinished";
+    else
+      sequenceTick(m, s);
+  }
+  return s.r.fault;
+}
+
+const char* runSequence(uint8_t format, const ProfileOp* ops, uint8_t n)
+{
+  if(format==14)
+    return runSequence<ClearPathMotorSDQ<14> >(ops, n);
+  else
+    return runSequence<ClearPathMotorSD>(ops, n);
+}
+
+/*
+  Shrinks a failing sequence to the commands it needs to fail the same way, and reports it
+*/
+void reportSequence(uint8_t format, ProfileOp* ops, uint8_t n, const char* fault)
+{
+  moves++;
+  if(!fault)
+    return;
+  failures++;
+  ProfileOp trial[PROFILE_SEQUENCE_OPS];
+  for(uint8_t i=0;i<n;)
+  {
+    //Try without command i
+    uint8_t k=0;
+    for(uint8_t j=0;j<n;j++)
+      if(j!=i)
+        trial[k++]=ops[j];
+    const char* f=runSequence(format, trial, k);
+    if(f==fault)
+    {
+      for(uint8_t j=0;j<k;j++)
+        ops[j]=trial[j];
+      n=k;
+    }
+    else
+      i++;
+  }
+
+  Serial.print("fail,sequence,Q");
+  Serial.print(format);
+  Serial.print(',');
+  Serial.print(fault);
+  for(uint8_t i=0;i<n;i++)
+  {
+    static const char* const names[]={"PROFILE_MOVE", "PROFILE_FAST", "PROFILE_STOP", "PROFILE_VEL",
+      "PROFILE_ACCEL", "PROFILE_ENABLE", "PROFILE_DISABLE", "PROFILE_FAST_STEPS", "PROFILE_MOVE_TO",
+      "PROFILE_SET_POSITION", "PROFILE_SOFT_LIMITS", "PROFILE_RECORD_MOVE", "PROFILE_PLAY_MOVE"};
+    Serial.print(",{");
+    Serial.print(names[ops[i].op]);
+    Serial.print(',');
+    Serial.print(ops[i].value);
+    Serial.print(',');
+    Serial.print(ops[i].ticks);
+    Serial.print('}');
+  }
+  Serial.print(",{PROFILE_END,");
+  Serial.print(format);
+  Serial.println(",0}");
+}
+
+/*
+  Runs the sequences of profileRegressions[]
+*/
+void checkRegressions()
+{
+  ProfileOp ops[PROFILE_SEQUENCE_OPS];
+  uint8_t n=0;
+  for(unsigned i=0;i<sizeof(profileRegressions)/sizeof(profileRegressions[0]);i++)
+  {
+    ProfileOp op;
+    memcpy_P(&op, &profileRegressions[i], sizeof(op));
+    if(op.op!=PROFILE_END)
+    {
+      if(n<PROFILE_SEQUENCE_OPS)
+        ops[n++]=op;
+      continue;
+    }
+    if(n)
+      reportSequence(op.value, ops, n, runSequence(op.value, ops, n));
+    n=0;
+  }
+}
+
+/*
+  Runs sequences of commands picked at random
+*/
+void checkSequences()
+{
+  uint32_t seed=88675123UL;
+  for(unsigned n=0;n<PROFILE_SEQUENCES;n++)
+  {
+    ProfileOp ops[PROFILE_SEQUENCE_OPS];
+    uint8_t format=10;
+    for(uint8_t i=0;i<PROFILE_SEQUENCE_OPS;i++)
+    {
+      //xorshift32
+      seed^=seed<<13;
+      seed^=seed>>17;
+      seed^=seed<<5;
+      if(i==0)
+        format= (seed & 1) ? 14 : 10;
+      uint8_t op=(seed>>1)%16;
+      long v=(long)(seed>>8);
+      //Mostly moves, and a sensible motor to start with
+      if(i<3)
+        op= i==0 ? PROFILE_VEL : i==1 ? PROFILE_ACCEL : PROFILE_ENABLE;
+      else if(op>PROFILE_PLAY_MOVE)
+        op=PROFILE_MOVE;
+      switch(op)
+      {
+        case PROFILE_MOVE:
+        case PROFILE_FAST:
+        case PROFILE_RECORD_MOVE:
+          //Short moves, where the move calculations take their special cases, half the time
+          v= (v & 1) ? v%20+1 : v%5000+1;
+          if(seed & 0x80)
+            v=-v;
+          break;
+        case PROFILE_VEL:
+          v=2000+v%98001;
+          break;
+        case PROFILE_ACCEL:
+          v=4000+v%1996001;
+          break;
+        case PROFILE_FAST_STEPS:
+          v=1+v%300;
+          break;
+        case PROFILE_MOVE_TO:
+          v=v%6001-3000;
+          break;
+        case PROFILE_SET_POSITION:
+          v=v%2001-1000;
+          break;
+        case PROFILE_SOFT_LIMITS:
+          v=v%6001-3000;
+          break;
+        default:
+          v=0;
+      }
+      seed^=seed<<13;
+      seed^=seed>>17;
+      seed^=seed<<5;
+      ops[i].op=op;
+      ops[i].value=v;
+      ops[i].ticks= (seed & 3) ? seed%200 : seed%3000;
+    }
+    reportSequence(format, ops, PROFILE_SEQUENCE_OPS, runSequence(format, ops, PROFILE_SEQUENCE_OPS));
+  }
+}
+
+// the setup routine runs once when you press reset:
+void setup()
+{
+  Serial.begin(115200);
+
+  checkGrid();
+#if !PROFILE_RECORD
+  checkRandom();
+  checkRegressions();
+  checkSequences();
+#endif
+
+  Serial.print("summary,");
+  Serial.print(moves);
+  Serial.print(',');
+  Serial.println(failures);
+  Serial.flush();
+}
+
+// the loop routine runs over and over again forever:
+void loop()
+{
+}
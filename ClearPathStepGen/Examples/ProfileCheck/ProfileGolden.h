@@ -0,0 +1,409 @@
+// Golden traces for ProfileCheck.ino, made with PROFILE_RECORD set to 1
+// Each entry is {ticks, crc} for one move of the grid, distance slowest and acceleration fastest
+struct ProfileGolden { uint16_t ticks; uint16_t crc; };
+const ProfileGolden profileGolden[2][200] PROGMEM = {
+ {
+  {54, 56673},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {54, 56673},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {54, 56673},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {54, 56673},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {54, 56673},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {79, 1355},
+  {20, 52617},
+  {10, 33370},
+  {4, 29883},
+  {79, 1355},
+  {20, 52617},
+  {10, 33370},
+  {3, 26738},
+  {79, 1355},
+  {20, 52617},
+  {10, 33370},
+  {3, 26738},
+  {79, 1355},
+  {20, 52617},
+  {10, 33370},
+  {3, 26738},
+  {79, 1355},
+  {20, 52617},
+  {10, 33370},
+  {3, 26738},
+  {98, 64739},
+  {25, 10334},
+  {12, 39534},
+  {5, 57628},
+  {98, 64739},
+  {25, 10334},
+  {12, 39534},
+  {4, 61287},
+  {98, 64739},
+  {25, 10334},
+  {12, 39534},
+  {4, 61287},
+  {98, 64739},
+  {25, 10334},
+  {12, 39534},
+  {4, 61287},
+  {98, 64739},
+  {25, 10334},
+  {12, 39534},
+  {4, 61287},
+  {124, 45815},
+  {34, 52489},
+  {15, 59459},
+  {7, 33241},
+  {124, 45815},
+  {34, 52489},
+  {15, 59459},
+  {5, 31407},
+  {124, 45815},
+  {34, 52489},
+  {15, 59459},
+  {5, 31407},
+  {124, 45815},
+  {34, 52489},
+  {15, 59459},
+  {5, 31407},
+  {124, 45815},
+  {34, 52489},
+  {15, 59459},
+  {5, 31407},
+  {183, 14995},
+  {48, 27682},
+  {22, 54854},
+  {12, 53899},
+  {183, 14995},
+  {48, 27682},
+  {22, 54854},
+  {7, 30169},
+  {183, 14995},
+  {48, 27682},
+  {22, 54854},
+  {7, 30169},
+  {183, 14995},
+  {48, 27682},
+  {22, 54854},
+  {7, 30169},
+  {183, 14995},
+  {48, 27682},
+  {22, 54854},
+  {7, 30169},
+  {356, 17017},
+  {96, 22551},
+  {51, 22178},
+  {39, 59200},
+  {356, 17017},
+  {96, 22551},
+  {45, 33785},
+  {18, 7576},
+  {356, 17017},
+  {96, 22551},
+  {45, 33785},
+  {13, 60997},
+  {356, 17017},
+  {96, 22551},
+  {45, 33785},
+  {13, 60997},
+  {356, 17017},
+  {96, 22551},
+  {45, 33785},
+  {13, 60997},
+  {600, 54222},
+  {169, 27586},
+  {113, 1971},
+  {102, 23079},
+  {600, 54222},
+  {164, 27481},
+  {78, 10528},
+  {43, 30754},
+  {600, 54222},
+  {164, 27481},
+  {78, 10528},
+  {22, 1972},
+  {600, 54222},
+  {164, 27481},
+  {78, 10528},
+  {22, 1972},
+  {600, 54222},
+  {164, 27481},
+  {78, 10528},
+  {22, 1972},
+  {1948, 30013},
+  {1069, 52044},
+  {1013, 11185},
+  {1002, 15014},
+  {1948, 30013},
+  {587, 22142},
+  {436, 43754},
+  {403, 60612},
+  {1948, 30013},
+  {542, 34299},
+  {259, 45571},
+  {112, 55171},
+  {1948, 30013},
+  {542, 34299},
+  {259, 45571},
+  {77, 14200},
+  {1948, 30013},
+  {542, 34299},
+  {259, 45571},
+  {77, 14200},
+  {13308, 19276},
+  {12411, 55859},
+  {12359, 22474},
+  {12347, 64224},
+  {7378, 39268},
+  {5125, 52237},
+  {4974, 47512},
+  {4941, 60263},
+  {6992, 2069},
+  {2039, 57712},
+  {1407, 28276},
+  {1247, 10716},
+  {6992, 2069},
+  {1975, 26608},
+  {951, 63785},
+  {457, 58637},
+  {6992, 2069},
+  {1975, 26608},
+  {951, 63785},
+  {326, 329},
+  {50950, 35203},
+  {50069, 25916},
+  {50013, 55566},
+  {50002, 8601},
+  {22440, 11086},
+  {20187, 8973},
+  {20036, 50696},
+  {20003, 58770},
+  {14138, 49740},
+  {5797, 13488},
+  {5170, 29804},
+  {5012, 32577},
+  {14138, 49740},
+  {4027, 40466},
+  {2219, 37002},
+  {1711, 38006},
+  {14138, 49740},
+  {4027, 40466},
+  {1942, 2677},
+  {1076, 50521},
+ },
+ {
+  {52, 25425},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {52, 25425},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {52, 25425},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {52, 25425},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {52, 25425},
+  {14, 40878},
+  {7, 39515},
+  {1, 11838},
+  {77, 17917},
+  {20, 7884},
+  {10, 33370},
+  {4, 29883},
+  {77, 17917},
+  {20, 7884},
+  {10, 33370},
+  {3, 26738},
+  {77, 17917},
+  {20, 7884},
+  {10, 33370},
+  {3, 26738},
+  {77, 17917},
+  {20, 7884},
+  {10, 33370},
+  {3, 26738},
+  {77, 17917},
+  {20, 7884},
+  {10, 33370},
+  {3, 26738},
+  {96, 50161},
+  {25, 45884},
+  {12, 39534},
+  {5, 57628},
+  {96, 50161},
+  {25, 45884},
+  {12, 39534},
+  {4, 61287},
+  {96, 50161},
+  {25, 45884},
+  {12, 39534},
+  {4, 61287},
+  {96, 50161},
+  {25, 45884},
+  {12, 39534},
+  {4, 61287},
+  {96, 50161},
+  {25, 45884},
+  {12, 39534},
+  {4, 61287},
+  {126, 63018},
+  {32, 5353},
+  {15, 59459},
+  {7, 33241},
+  {126, 63018},
+  {32, 5353},
+  {15, 59459},
+  {5, 31407},
+  {126, 63018},
+  {32, 5353},
+  {15, 59459},
+  {5, 31407},
+  {126, 63018},
+  {32, 5353},
+  {15, 59459},
+  {5, 31407},
+  {126, 63018},
+  {32, 5353},
+  {15, 59459},
+  {5, 31407},
+  {179, 30898},
+  {47, 21071},
+  {22, 54854},
+  {12, 53899},
+  {179, 30898},
+  {47, 21071},
+  {22, 54854},
+  {7, 30169},
+  {179, 30898},
+  {47, 21071},
+  {22, 54854},
+  {7, 30169},
+  {179, 30898},
+  {47, 21071},
+  {22, 54854},
+  {7, 30169},
+  {179, 30898},
+  {47, 21071},
+  {22, 54854},
+  {7, 30169},
+  {360, 59130},
+  {94, 10579},
+  {51, 22178},
+  {39, 59200},
+  {360, 59130},
+  {94, 10579},
+  {44, 46258},
+  {18, 7576},
+  {360, 59130},
+  {94, 10579},
+  {44, 46258},
+  {13, 60997},
+  {360, 59130},
+  {94, 10579},
+  {44, 46258},
+  {13, 60997},
+  {360, 59130},
+  {94, 10579},
+  {44, 46258},
+  {13, 60997},
+  {594, 52292},
+  {162, 53527},
+  {113, 1971},
+  {102, 23079},
+  {594, 52292},
+  {160, 1118},
+  {77, 1720},
+  {43, 30754},
+  {594, 52292},
+  {160, 1118},
+  {77, 1720},
+  {22, 1972},
+  {594, 52292},
+  {160, 1118},
+  {77, 1720},
+  {22, 1972},
+  {594, 52292},
+  {160, 1118},
+  {77, 1720},
+  {22, 1972},
+  {1961, 11013},
+  {1062, 16366},
+  {1013, 11185},
+  {1002, 15014},
+  {1961, 11013},
+  {570, 23995},
+  {436, 12009},
+  {403, 60612},
+  {1961, 11013},
+  {528, 39},
+  {257, 23250},
+  {112, 55171},
+  {1961, 11013},
+  {528, 39},
+  {257, 23250},
+  {77, 14200},
+  {1961, 11013},
+  {528, 39},
+  {257, 23250},
+  {77, 14200},
+  {13294, 47616},
+  {12410, 43140},
+  {12359, 22474},
+  {12347, 64224},
+  {7359, 56291},
+  {5108, 39406},
+  {4974, 18452},
+  {4941, 60263},
+  {6966, 8678},
+  {1991, 23656},
+  {1406, 9084},
+  {1247, 10716},
+  {6966, 8678},
+  {1923, 7528},
+  {951, 17997},
+  {457, 58637},
+  {6966, 8678},
+  {1923, 7528},
+  {951, 17997},
+  {326, 329},
+  {50938, 38096},
+  {50062, 20460},
+  {50013, 55566},
+  {50002, 8601},
+  {22421, 21661},
+  {20170, 49946},
+  {20036, 40040},
+  {20003, 58770},
+  {14102, 32130},
+  {5749, 38968},
+  {5169, 52297},
+  {5012, 32577},
+  {14102, 32130},
+  {3917, 28816},
+  {2217, 46086},
+  {1711, 38006},
+  {14102, 32130},
+  {3917, 28816},
+  {1918, 31572},
+  {1076, 50521},
+ },
+};
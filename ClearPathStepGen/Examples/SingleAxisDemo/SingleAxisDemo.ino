@@ -33,7 +33,7 @@ X.attach(8,9,6,4);          //Direction/A is pin 8, Step/B is pin 9, Enable is p
 // Set max Acceleration.  Parameter can be between 4000 and 2,000,000 steps/sec/sec
   X.setMaxAccel(2000000);
   
-// Enable motor, reset the motor position to 0
+// Enable motor, it keeps its commanded position (call X.setPosition(0) to zero it where it is)
 X.enable();
 
 delay(100);
@@ -0,0 +1,245 @@
+/*
+  Sync Check
+  Checks ClearPathStepGen::moveSync() with the step generator and its ISR running, as a sketch would use it.
+
+  Each check makes synchronized moves on three motors and checks:
+    - every motor ends exactly on its target, and all of them finish together
+    - while the move runs, each motor stays in step with the longest move, to within a couple of counts of its
+      share of it
+    - a second moveSync() made while the first is still running is rejected, even on a motor the first one left
+      alone, and does not disturb the first
+    - a motor stopped with stopMove() during a moveSync() does not block the next one
+
+  No motors are needed, only pins 8-13 are driven.  The results are printed over Serial, one line per failure
+  and a summary.  It also runs on a PC with g++:
+
+    make -C extras/host SyncCheck		(from the library's folder)
+
+  Lines are comma separated:
+
+    fail,<check>,<reason>
+    summary,<checks>,<failures>
+
+ Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+ */
+
+
+
+//Import Required libraries
+#include <ClearPathMotorSD.h>
+#include <ClearPathStepGen.h>
+
+#if !CLEARPATH_SYNC_MOVES
+#error "SyncCheck checks moveSync(), set CLEARPATH_SYNC_MOVES to 1"
+#endif
+
+#define SYNC_TIMEOUT 10000		// Milliseconds a move may take before it has failed to finish
+#define SYNC_SLACK 2				// Counts a motor may be off its share of the longest move while it runs
+
+// initialize three ClearPathMotorSD Motors
+ClearPathMotorSD M[3];
+
+//initialize the controller and pass the references to the motors
+ClearPathStepGen machine(&M[0],&M[1],&M[2]);
+
+unsigned long checks=0;
+unsigned long failures=0;
+
+void fail(const char* check, const char* reason)
+{
+  failures++;
+  Serial.print("fail,");
+  Serial.print(check);
+  Serial.print(',');
+  Serial.println(reason);
+}
+
+// Reads every motor's commanded position on the same tick
+void positions(long* pos)
+{
+  cli();
+  for(uint8_t i=0;i<3;i++)
+    pos[i]=M[i].getCommandedPosition();
+  sei();
+}
+
+boolean allDone()
+{
+  for(uint8_t i=0;i<3;i++)
+    if(!M[i].commandDone())
+      return false;
+  return true;
+}
+
+/*
+  Waits for the moveSync() of dist[] started at start[] to finish, checking every millisecond that each motor is
+  within SYNC_SLACK counts of its share of the longest move.  After ms milliseconds it calls next() once, which
+  may start or stop other commands, then carries on.  Returns false once it has reported a failure.
+*/
+boolean followSync(const char* check, const long* start, const long* dist, unsigned ms, void (*next)())
+{
+  uint8_t lead=0;
+  for(uint8_t i=1;i<3;i++)
+    if(labs(dist[i])>labs(dist[lead]))
+      lead=i;
+  boolean followed=true;
+  for(unsigned t=0; !allDone(); t++)
+  {
+    if(t==ms && next)
+      next();
+    if(t>SYNC_TIMEOUT)
+    {
+      fail(check, "did not finish");
+      return false;
+    }
+    long pos[3];
+    positions(pos);
+    float share=(float)(pos[lead]-start[lead])/dist[lead];
+    for(uint8_t i=0;i<3;i++)
+      if(fabs(pos[i]-start[i]-share*dist[i])>SYNC_SLACK)
+        followed=false;
+    delay(1);
+  }
+  if(!followed)
+  {
+    fail(check, "a motor fell out of step with the longest move");
+    return false;
+  }
+  long pos[3];
+  positions(pos);
+  for(uint8_t i=0;i<3;i++)
+    if(pos[i]!=start[i]+dist[i])
+    {
+      fail(check, "a motor did not end on its target");
+      return false;
+    }
+  return true;
+}
+
+// Runs a moveSync() of dist[] to the end, and checks it
+boolean syncMove(const char* check, long d0, long d1, long d2)
+{
+  long dist[3]={d0, d1, d2};
+  long start[3];
+  positions(start);
+  if(!machine.moveSync(d0, d1, d2))
+  {
+    fail(check, "moveSync() was rejected");
+    return false;
+  }
+  return followSync(check, start, dist, 0, 0);
+}
+
+boolean overlapRejected;
+
+void overlap()
+{
+  //The third motor has no command, but the first moveSync() is still running
+  overlapRejected= !machine.moveSync(0, 0, 3000) && !machine.moveSync(0, 100, 0);
+}
+
+/*
+  A second moveSync() while the first is running must be rejected, and must not disturb the first
+*/
+void checkOverlap()
+{
+  checks++;
+  long dist[3]={20000, -5000, 0};
+  long start[3];
+  positions(start);
+  if(!machine.moveSync(dist[0], dist[1], dist[2]))
+  {
+    fail("overlap", "moveSync() was rejected");
+    return;
+  }
+  overlapRejected=false;
+  if(!followSync("overlap", start, dist, 50, overlap))
+    return;
+  if(!overlapRejected)
+  {
+    fail("overlap", "a second moveSync() was accepted while the first ran");
+    return;
+  }
+  syncMove("overlap", 0, 0, 3000);
+}
+
+void stopFollowers()
+{
+  M[0].stopMove();
+  M[1].stopMove();
+}
+
+/*
+  Stopping every motor of a moveSync() must leave the step generator free for the next one
+*/
+void checkStopped()
+{
+  checks++;
+  long dist[3]={10000, 10000, 0};
+  long start[3];
+  positions(start);
+  if(!machine.moveSync(dist[0], dist[1], dist[2]))
+  {
+    fail("stopped", "moveSync() was rejected");
+    return;
+  }
+  for(unsigned t=0; t<20; t++)
+    delay(1);
+  stopFollowers();
+  if(!allDone())
+  {
+    fail("stopped", "stopMove() left a command");
+    return;
+  }
+  syncMove("stopped", 0, -2000, -3000);
+}
+
+/*
+  Moves of several lengths, in both directions, each ending where the last one left off
+*/
+void checkMoves()
+{
+  checks++;
+  if(!syncMove("moves", 20000, -5000, 3000))
+    return;
+  if(!syncMove("moves", -7, 3, 2))
+    return;
+  if(!syncMove("moves", 1000, 20000, -19000))
+    return;
+  syncMove("moves", 0, 0, 9000);
+}
+
+// the setup routine runs once when you press reset:
+void setup()
+{
+  Serial.begin(115200);
+
+  //Direction/A on 8, 10 and 12, Step/B on 9, 11 and 13
+  for(uint8_t i=0;i<3;i++)
+  {
+    M[i].attach(8+2*i, 9+2*i);
+    M[i].setMaxVel(60000);
+    M[i].setMaxAccel(400000);
+    M[i].enable();
+  }
+  M[1].setMaxVel(30000);
+  M[2].setMaxAccel(100000);
+  machine.Start();
+
+  checkMoves();
+  checkOverlap();
+  checkStopped();
+
+  machine.Stop();
+  Serial.print("summary,");
+  Serial.print(checks);
+  Serial.print(',');
+  Serial.println(failures);
+  Serial.flush();
+}
+
+// the loop routine runs over and over again forever:
+void loop()
+{
+}
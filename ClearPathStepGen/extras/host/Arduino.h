@@ -0,0 +1,166 @@
+/*
+  Arduino.h - Host stand-in for the parts of the Arduino AVR core the ClearPath library uses- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+/*
+  This lets the library and the check sketches in Examples build and run on a PC with g++, see the Makefile
+  next to it.  It is never seen by the Arduino IDE, which does not compile anything under extras.
+
+  The AVR registers the library touches are plain variables, and time only passes inside delay(): each
+  millisecond the running timers count, and the compare interrupts they raise run the library's ISRs, as
+  they would on the board.  delayMicroseconds() takes no time, it counts the step pulses on PORTB into
+  hostSteps[] instead.  Nothing here counts AVR cycles, so timings from the host mean nothing.
+
+  The board is picked with -D__AVR_ATmega328P__ (Uno, the default) or -D__AVR_ATmega2560__ (Mega), which
+  decides the timers there are.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#if !defined(__AVR_ATmega328P__) && !defined(__AVR_ATmega2560__)
+#define __AVR_ATmega328P__ 1
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define F_CPU 16000000UL
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define PI 3.1415926535897932384626433832795
+
+#undef abs
+#define abs(x) ((x)>0?(x):-(x))
+
+// Flash is ordinary memory on the host
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define memcpy_P memcpy
+
+// An ISR is an ordinary function, run by delay() when its interrupt is due
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+#define ISR_NOBLOCK
+
+// Registers
+extern volatile uint8_t SREG;
+#define SREG_I 7
+extern volatile uint8_t PORTB, PORTC, PORTD;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+#define TCCR0A TCCR0A
+#define TCCR1A TCCR1A
+#define TCCR2A TCCR2A
+#if defined(__AVR_ATmega2560__)
+extern volatile uint8_t PORTA, PORTL;
+extern volatile uint8_t TCCR3A, TCCR3B, TCCR3C, TIMSK3, TIFR3;
+extern volatile uint16_t TCNT3, OCR3A, OCR3B;
+extern volatile uint8_t TCCR4A, TCCR4B, TCCR4C, TIMSK4, TIFR4;
+extern volatile uint16_t TCNT4, OCR4A, OCR4B;
+extern volatile uint8_t TCCR5A, TCCR5B, TCCR5C, TIMSK5, TIFR5;
+extern volatile uint16_t TCNT5, OCR5A, OCR5B;
+#define TCCR3A TCCR3A
+#define TCCR4A TCCR4A
+#define TCCR5A TCCR5A
+#endif
+
+// Register bits, the same on every timer of a kind
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM21 1
+#define WGM22 3
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define TOV2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define OCF2A 1
+#define OCF2B 2
+#define WGM12 3
+#define WGM13 4
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A 1
+#define OCF1B 2
+#if defined(__AVR_ATmega2560__)
+#define WGM32 3
+#define WGM42 3
+#define WGM52 3
+#define CS31 1
+#define CS41 1
+#define CS51 1
+#define OCIE3A 1
+#define OCIE3B 2
+#define OCF3A 1
+#define OCF3B 2
+#define OCIE4A 1
+#define OCIE4B 2
+#define OCF4A 1
+#define OCF4B 2
+#define OCIE5A 1
+#define OCIE5B 2
+#define OCF5A 1
+#define OCF5B 2
+#endif
+
+void cli();
+void sei();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+
+// What the host saw, for checks which run only on the host
+extern uint8_t hostPin[70];				// Last level written to each pin
+extern unsigned long hostSteps[6];		// Step pulses sent on each of PORTB's pins 8-13
+
+// Serial prints to stdout
+class HostSerial
+{
+public:
+  void begin(unsigned long) {}
+  void flush() { fflush(stdout); }
+  void print(const char* s) { fputs(s, stdout); }
+  void print(char c) { putchar(c); }
+  void print(int v) { printf("%d", v); }
+  void print(unsigned int v) { printf("%u", v); }
+  void print(long v) { printf("%ld", v); }
+  void print(unsigned long v) { printf("%lu", v); }
+  void print(double v) { printf("%.2f", v); }
+  template<class T> void println(T v) { print(v); putchar('\n'); }
+  void println() { putchar('\n'); }
+};
+extern HostSerial Serial;
+
+#endif
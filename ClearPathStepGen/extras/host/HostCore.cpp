@@ -0,0 +1,167 @@
+/*
+  HostCore.cpp - Host stand-in for the Arduino AVR core, see Arduino.h- Version 1
+  Teknic 2017 Brendan Flosenzier
+
+  Copyright (c) 2017 Teknic Inc. This work is free to use, copy and distribute under the terms of the standard
+  MIT permissive software license which can be found at https://opensource.org/licenses/MIT
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+#include "Arduino.h"
+
+volatile uint8_t SREG=1<<SREG_I;
+volatile uint8_t PORTB, PORTC, PORTD;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+#if defined(__AVR_ATmega2560__)
+volatile uint8_t PORTA, PORTL;
+volatile uint8_t TCCR3A, TCCR3B, TCCR3C, TIMSK3, TIFR3;
+volatile uint16_t TCNT3, OCR3A, OCR3B;
+volatile uint8_t TCCR4A, TCCR4B, TCCR4C, TIMSK4, TIFR4;
+volatile uint16_t TCNT4, OCR4A, OCR4B;
+volatile uint8_t TCCR5A, TCCR5B, TCCR5C, TIMSK5, TIFR5;
+volatile uint16_t TCNT5, OCR5A, OCR5B;
+#endif
+
+uint8_t hostPin[70];
+unsigned long hostSteps[6];
+HostSerial Serial;
+
+// The vectors of a sketch which does not use a timer are left out, weak references to them are then 0
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPB_vect(void) __attribute__((weak));
+#if defined(__AVR_ATmega2560__)
+extern "C" void TIMER3_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER3_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER4_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER4_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER5_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER5_COMPB_vect(void) __attribute__((weak));
+#endif
+
+// One timer, counting in CTC mode up to its A compare, or freely when CTC is off
+struct HostTimer
+{
+	volatile uint8_t* tccrA;
+	volatile uint8_t* tccrB;
+	volatile uint8_t* timsk;
+	volatile uint8_t* tifr;
+	volatile uint8_t* tcnt8;		// The 8 bit timer's registers...
+	volatile uint8_t* ocrA8;
+	volatile uint8_t* ocrB8;
+	volatile uint16_t* tcnt16;		// ...or the 16 bit timer's
+	volatile uint16_t* ocrA16;
+	volatile uint16_t* ocrB16;
+	void (*compA)(void);
+	void (*compB)(void);
+	unsigned long cycles;			// CPU cycles not yet counted by the prescaler
+
+	// The prescale picked by the clock select bits, 0 while the timer is stopped
+	uint16_t prescale() const
+	{
+		static const uint16_t timer2[8]={0, 1, 8, 32, 64, 128, 256, 1024};
+		static const uint16_t timer16[8]={0, 1, 8, 64, 256, 1024, 0, 0};
+		uint8_t cs=*tccrB & 7;
+		return tcnt8 ? timer2[cs] : timer16[cs];
+	}
+	boolean ctc() const { return tcnt8 ? (*tccrA & (1<<WGM21)) : (*tccrB & (1<<WGM12)); }
+	uint16_t count() const { return tcnt8 ? *tcnt8 : *tcnt16; }
+	void setCount(uint16_t c) { if(tcnt8) *tcnt8=c; else *tcnt16=c; }
+	uint16_t compareA() const { return tcnt8 ? *ocrA8 : *ocrA16; }
+	uint16_t compareB() const { return tcnt8 ? *ocrB8 : *ocrB16; }
+	uint16_t top() const { return ctc() ? compareA() : (tcnt8 ? 255 : 65535); }
+
+	// Counts one timer clock, setting the compare flags the count reaches
+	void clock()
+	{
+		uint16_t c= count()>=top() ? 0 : count()+1;
+		setCount(c);
+		if(c==compareA())
+			*tifr|=1<<1;
+		if(c==compareB())
+			*tifr|=1<<2;
+	}
+
+	// Runs the ISR of each flag which is set and enabled, while interrupts are on
+	void interrupt()
+	{
+		for(uint8_t bit=1; bit<=2; bit++)
+		{
+			void (*vector)(void)= bit==1 ? compA : compB;
+			if(!(SREG & (1<<SREG_I)) || !(*tifr & (1<<bit)) || !(*timsk & (1<<bit)) || !vector)
+				continue;
+			*tifr&=~(1<<bit);
+			SREG&=~(1<<SREG_I);		//The ISR starts with interrupts off, and reti turns them back on
+			vector();
+			SREG|=1<<SREG_I;
+		}
+	}
+};
+
+static HostTimer hostTimers[]=
+{
+	{ &TCCR1A, &TCCR1B, &TIMSK1, &TIFR1, 0, 0, 0, &TCNT1, &OCR1A, &OCR1B, TIMER1_COMPA_vect, TIMER1_COMPB_vect, 0 },
+	{ &TCCR2A, &TCCR2B, &TIMSK2, &TIFR2, &TCNT2, &OCR2A, &OCR2B, 0, 0, 0, TIMER2_COMPA_vect, TIMER2_COMPB_vect, 0 },
+#if defined(__AVR_ATmega2560__)
+	{ &TCCR3A, &TCCR3B, &TIMSK3, &TIFR3, 0, 0, 0, &TCNT3, &OCR3A, &OCR3B, TIMER3_COMPA_vect, TIMER3_COMPB_vect, 0 },
+	{ &TCCR4A, &TCCR4B, &TIMSK4, &TIFR4, 0, 0, 0, &TCNT4, &OCR4A, &OCR4B, TIMER4_COMPA_vect, TIMER4_COMPB_vect, 0 },
+	{ &TCCR5A, &TCCR5B, &TIMSK5, &TIFR5, 0, 0, 0, &TCNT5, &OCR5A, &OCR5B, TIMER5_COMPA_vect, TIMER5_COMPB_vect, 0 },
+#endif
+};
+#define HOST_TIMERS (sizeof(hostTimers)/sizeof(hostTimers[0]))
+
+static unsigned long long hostCycles=0;
+
+// Lets cycles of CPU time pass, one microsecond at a time, running every interrupt which comes due
+static void hostRun(unsigned long long cycles)
+{
+	const uint8_t step=F_CPU/1000000UL;
+	for(unsigned long long done=0; done<cycles; done+=step)
+	{
+		hostCycles+=step;
+		for(uint8_t i=0;i<HOST_TIMERS;i++)
+		{
+			HostTimer& t=hostTimers[i];
+			uint16_t prescale=t.prescale();
+			if(prescale==0)
+				continue;
+			for(t.cycles+=step; t.cycles>=prescale; t.cycles-=prescale)
+				t.clock();
+			t.interrupt();
+		}
+	}
+}
+
+void cli() { SREG&=~(1<<SREG_I); }
+void sei() { SREG|=1<<SREG_I; }
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t val) { if(pin<sizeof(hostPin)) hostPin[pin]=val; }
+int digitalRead(uint8_t pin) { return pin<sizeof(hostPin) ? hostPin[pin] : LOW; }
+
+void delay(unsigned long ms) { hostRun((unsigned long long)ms*(F_CPU/1000UL)); }
+
+void delayMicroseconds(unsigned int)
+{
+	for(uint8_t b=0;b<6;b++)
+		if(PORTB & (1<<b))
+			hostSteps[b]++;
+}
+
+unsigned long millis() { return hostCycles/(F_CPU/1000UL); }
+unsigned long micros() { return hostCycles/(F_CPU/1000000UL); }
+
+// A sketch runs setup() once, its loop() is never called as the check sketches do all their work in setup()
+void setup();
+
+int main()
+{
+	setup();
+	return 0;
+}
@@ -0,0 +1,14 @@
+/*
+  avr/sleep.h - Host stand-in for avr-libc's sleep functions, see ../Arduino.h
+  A sketch which puts the processor to sleep with interrupts off is done, so on the host sleep_cpu() ends it.
+*/
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+#include <stdlib.h>
+
+static inline void sleep_enable() {}
+static inline void sleep_disable() {}
+static inline void set_sleep_mode(uint8_t) {}
+static inline void sleep_cpu() { exit(0); }
+
+#endif